@@ -0,0 +1,435 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Visitor.h"
+
+// Sorted set with wide nodes: every node keeps up to 2 * Degree - 1 keys side by side, so a lookup
+// touches about log_Degree(n) nodes instead of log_2(n). The default degree sizes the key array of
+// a node to roughly two cache lines. Same insert/contains/remove/traverse interface as BinaryTree.
+template<typename T, int Degree = std::max<int>(2, 64 / sizeof(T))>
+class BTree {
+    static_assert(Degree >= 2, "A B-tree needs a minimum degree of at least 2");
+
+private:
+    static constexpr int MAX_KEYS = 2 * Degree - 1;
+    static constexpr int MIN_KEYS = Degree - 1;
+
+    struct Node {
+        int count;
+        bool leaf;
+        T keys[MAX_KEYS];
+
+        explicit Node(bool isLeaf) : count(0), leaf(isLeaf) {
+        }
+    };
+
+    // Leaves carry no child array.
+    struct Inner : Node {
+        Node *children[MAX_KEYS + 1];
+
+        Inner() : Node(false) {
+        }
+    };
+
+    Node *root;
+    int itemCount;
+
+    static Node *&child(Node *node, int index) {
+        return static_cast<Inner *>(node)->children[index];
+    }
+
+    static const Node *child(const Node *node, int index) {
+        return static_cast<const Inner *>(node)->children[index];
+    }
+
+    static void destroyNode(Node *node) {
+        if (node->leaf) {
+            delete node;
+        } else {
+            delete static_cast<Inner *>(node);
+        }
+    }
+
+    // Index of the first key not less than the item. Arithmetic keys are counted with a plain
+    // branch-free loop the compiler turns into SIMD compares; other keys use binary search.
+    static int position(const Node *node, const T &item) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            int index = 0;
+            for (int i = 0; i < node->count; i++) {
+                index += node->keys[i] < item;
+            }
+            return index;
+        } else {
+            return static_cast<int>(std::lower_bound(node->keys, node->keys + node->count, item) - node->keys);
+        }
+    }
+
+    static bool matches(const Node *node, int index, const T &item) {
+        return index < node->count && !(item < node->keys[index]);
+    }
+
+    void deleteTree(Node *node) {
+        if (!node) return;
+        if (!node->leaf) {
+            for (int i = 0; i <= node->count; i++) {
+                deleteTree(child(node, i));
+            }
+        }
+        destroyNode(node);
+    }
+
+    Node *copyTree(const Node *node) {
+        if (!node) return nullptr;
+
+        Node *copy = node->leaf ? new Node(true) : new Inner();
+        std::copy(node->keys, node->keys + node->count, copy->keys);
+        copy->count = node->count;
+        if (!node->leaf) {
+            for (int i = 0; i <= node->count; i++) {
+                child(copy, i) = copyTree(child(node, i));
+            }
+        }
+        return copy;
+    }
+
+    // Splits the full child at index into two halves and lifts its median into the parent.
+    void splitChild(Node *parent, int index) {
+        Node *full = child(parent, index);
+        Node *sibling = full->leaf ? new Node(true) : new Inner();
+
+        std::move(full->keys + Degree, full->keys + MAX_KEYS, sibling->keys);
+        if (!full->leaf) {
+            std::copy(&child(full, Degree), &child(full, Degree) + Degree, &child(sibling, 0));
+        }
+        sibling->count = MIN_KEYS;
+        full->count = MIN_KEYS;
+
+        std::move_backward(parent->keys + index, parent->keys + parent->count, parent->keys + parent->count + 1);
+        std::copy_backward(&child(parent, index + 1), &child(parent, parent->count + 1), &child(parent, parent->count + 2));
+        parent->keys[index] = std::move(full->keys[MIN_KEYS]);
+        child(parent, index + 1) = sibling;
+        parent->count++;
+    }
+
+    // Appends the separator at index and the right child to the left child, removing both from the parent.
+    void mergeChildren(Node *parent, int index) {
+        Node *left = child(parent, index);
+        Node *right = child(parent, index + 1);
+
+        left->keys[left->count] = std::move(parent->keys[index]);
+        std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+        if (!left->leaf) {
+            std::copy(&child(right, 0), &child(right, right->count + 1), &child(left, left->count + 1));
+        }
+        left->count += right->count + 1;
+
+        std::move(parent->keys + index + 1, parent->keys + parent->count, parent->keys + index);
+        std::copy(&child(parent, index + 2), &child(parent, parent->count + 1), &child(parent, index + 1));
+        parent->count--;
+        destroyNode(right);
+    }
+
+    // Moves a key from the left sibling through the parent into the child at index.
+    void borrowFromLeft(Node *parent, int index) {
+        Node *target = child(parent, index);
+        Node *donor = child(parent, index - 1);
+
+        std::move_backward(target->keys, target->keys + target->count, target->keys + target->count + 1);
+        target->keys[0] = std::move(parent->keys[index - 1]);
+        parent->keys[index - 1] = std::move(donor->keys[donor->count - 1]);
+        if (!target->leaf) {
+            std::copy_backward(&child(target, 0), &child(target, target->count + 1), &child(target, target->count + 2));
+            child(target, 0) = child(donor, donor->count);
+        }
+        target->count++;
+        donor->count--;
+    }
+
+    // Moves a key from the right sibling through the parent into the child at index.
+    void borrowFromRight(Node *parent, int index) {
+        Node *target = child(parent, index);
+        Node *donor = child(parent, index + 1);
+
+        target->keys[target->count] = std::move(parent->keys[index]);
+        parent->keys[index] = std::move(donor->keys[0]);
+        std::move(donor->keys + 1, donor->keys + donor->count, donor->keys);
+        if (!target->leaf) {
+            child(target, target->count + 1) = child(donor, 0);
+            std::copy(&child(donor, 1), &child(donor, donor->count + 1), &child(donor, 0));
+        }
+        target->count++;
+        donor->count--;
+    }
+
+    // Single top-down pass: every child entered already has more than the minimum number of keys,
+    // so the key can be taken out of a leaf without fixing anything on the way back up.
+    bool removeKey(const T &target) {
+        T item = target;
+        Node *node = root;
+        while (true) {
+            int index = position(node, item);
+            bool found = matches(node, index, item);
+
+            if (node->leaf) {
+                if (!found) return false;
+                std::move(node->keys + index + 1, node->keys + node->count, node->keys + index);
+                node->count--;
+                return true;
+            }
+
+            if (found) {
+                Node *left = child(node, index);
+                Node *right = child(node, index + 1);
+                if (left->count > MIN_KEYS) {
+                    while (!left->leaf) left = child(left, left->count);
+                    item = left->keys[left->count - 1];
+                    node->keys[index] = item;
+                    node = child(node, index);
+                } else if (right->count > MIN_KEYS) {
+                    while (!right->leaf) right = child(right, 0);
+                    item = right->keys[0];
+                    node->keys[index] = item;
+                    node = child(node, index + 1);
+                } else {
+                    mergeChildren(node, index);
+                    node = left;
+                }
+                continue;
+            }
+
+            if (child(node, index)->count == MIN_KEYS) {
+                if (index > 0 && child(node, index - 1)->count > MIN_KEYS) {
+                    borrowFromLeft(node, index);
+                } else if (index < node->count && child(node, index + 1)->count > MIN_KEYS) {
+                    borrowFromRight(node, index);
+                } else {
+                    if (index == node->count) index--;
+                    mergeChildren(node, index);
+                }
+            }
+            node = child(node, index);
+        }
+    }
+
+public:
+    // Forward iterator over the keys in ascending order.
+    class InOrderIterator {
+    private:
+        std::vector<std::pair<const Node *, int> > path;
+
+        friend class BTree;
+
+        void descendLeft(const Node *node) {
+            while (node) {
+                path.push_back({node, 0});
+                node = node->leaf ? nullptr : child(node, 0);
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        InOrderIterator() = default;
+
+        reference operator*() const {
+            return path.back().first->keys[path.back().second];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        InOrderIterator &operator++() {
+            auto &[node, index] = path.back();
+            index++;
+            if (!node->leaf) {
+                descendLeft(child(node, index));
+            } else {
+                while (!path.empty() && path.back().second == path.back().first->count) {
+                    path.pop_back();
+                }
+            }
+            return *this;
+        }
+
+        InOrderIterator operator++(int) {
+            InOrderIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const InOrderIterator &other) const {
+            if (path.empty() || other.path.empty()) return path.empty() && other.path.empty();
+            return path.back() == other.path.back();
+        }
+
+        bool operator!=(const InOrderIterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = InOrderIterator;
+    using const_iterator = InOrderIterator;
+    using value_type = T;
+
+    BTree() : root(nullptr), itemCount(0) {
+    }
+
+    BTree(const BTree &other) : root(nullptr), itemCount(other.itemCount) {
+        root = copyTree(other.root);
+    }
+
+    BTree &operator=(const BTree &other) {
+        if (this != &other) {
+            clear();
+            root = copyTree(other.root);
+            itemCount = other.itemCount;
+        }
+        return *this;
+    }
+
+    BTree(BTree &&other) noexcept : root(other.root), itemCount(other.itemCount) {
+        other.root = nullptr;
+        other.itemCount = 0;
+    }
+
+    BTree &operator=(BTree &&other) noexcept {
+        if (this != &other) {
+            clear();
+            root = other.root;
+            itemCount = other.itemCount;
+            other.root = nullptr;
+            other.itemCount = 0;
+        }
+        return *this;
+    }
+
+    ~BTree() {
+        clear();
+    }
+
+    InOrderIterator begin() const {
+        InOrderIterator it;
+        it.descendLeft(root);
+        return it;
+    }
+
+    InOrderIterator end() const {
+        return InOrderIterator();
+    }
+
+    // Full nodes are split on the way down, so the new key always lands in a leaf with room.
+    void insert(const T &item) {
+        if (!root) {
+            root = new Node(true);
+        } else if (root->count == MAX_KEYS) {
+            Inner *newRoot = new Inner();
+            newRoot->children[0] = root;
+            root = newRoot;
+            splitChild(root, 0);
+        }
+
+        Node *node = root;
+        while (true) {
+            int index = position(node, item);
+            if (matches(node, index, item)) return;
+
+            if (node->leaf) {
+                std::move_backward(node->keys + index, node->keys + node->count, node->keys + node->count + 1);
+                node->keys[index] = item;
+                node->count++;
+                itemCount++;
+                return;
+            }
+
+            if (child(node, index)->count == MAX_KEYS) {
+                splitChild(node, index);
+                if (node->keys[index] < item) {
+                    index++;
+                } else if (!(item < node->keys[index])) {
+                    return;
+                }
+            }
+            node = child(node, index);
+        }
+    }
+
+    bool contains(const T &item) const {
+        const Node *node = root;
+        while (node) {
+            int index = position(node, item);
+            if (matches(node, index, item)) return true;
+            node = node->leaf ? nullptr : child(node, index);
+        }
+        return false;
+    }
+
+    void remove(const T &item) {
+        if (!root) return;
+
+        if (removeKey(item)) {
+            itemCount--;
+        }
+
+        if (root->count == 0) {
+            Node *emptyRoot = root;
+            root = root->leaf ? nullptr : child(root, 0);
+            destroyNode(emptyRoot);
+        }
+    }
+
+    void clear() {
+        deleteTree(root);
+        root = nullptr;
+        itemCount = 0;
+    }
+
+    std::vector<T> traverseInOrder() const {
+        std::vector<T> result;
+        result.reserve(itemCount);
+        for (const T &item: *this) {
+            result.push_back(item);
+        }
+        return result;
+    }
+
+    // Visits the items in [low, high] in order, until a visit returns false.
+    template<typename Visit>
+    void rangeVisit(const T &low, const T &high, Visit &&visit) const {
+        InOrderIterator it;
+        const Node *node = root;
+        while (node) {
+            int index = position(node, low);
+            it.path.push_back({node, index});
+            node = node->leaf ? nullptr : child(node, index);
+        }
+        while (!it.path.empty() && it.path.back().second == it.path.back().first->count) {
+            it.path.pop_back();
+        }
+
+        for (; it != end() && !(high < *it); ++it) {
+            if (!proceed(visit, *it)) return;
+        }
+    }
+
+    bool isEmpty() const {
+        return root == nullptr;
+    }
+
+    int size() const {
+        return itemCount;
+    }
+};
+
+#endif
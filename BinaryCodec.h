@@ -0,0 +1,208 @@
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Byte sinks and sources used by the binary tree snapshot format. Any type with
+// writeBytes/writeByte (or readBytes/readByte) can stand in for them.
+
+class StringWriter {
+private:
+    std::string &out;
+
+public:
+    explicit StringWriter(std::string &target) : out(target) {
+    }
+
+    void writeBytes(const void *data, size_t size) {
+        out.append(static_cast<const char *>(data), size);
+    }
+
+    void writeByte(uint8_t byte) {
+        out.push_back(static_cast<char>(byte));
+    }
+};
+
+class StringReader {
+private:
+    const char *cursor;
+    const char *end;
+
+public:
+    explicit StringReader(const std::string &source) : cursor(source.data()), end(source.data() + source.size()) {
+    }
+
+    void readBytes(void *data, size_t size) {
+        if (size > static_cast<size_t>(end - cursor)) {
+            throw std::runtime_error("Unexpected end of binary data");
+        }
+        std::memcpy(data, cursor, size);
+        cursor += size;
+    }
+
+    size_t remaining() const {
+        return static_cast<size_t>(end - cursor);
+    }
+
+    uint8_t readByte() {
+        if (cursor == end) {
+            throw std::runtime_error("Unexpected end of binary data");
+        }
+        return static_cast<uint8_t>(*cursor++);
+    }
+};
+
+// Unbuffered adapters over iostreams; the stream's own buffer bounds the memory in use.
+class StreamWriter {
+private:
+    std::ostream &out;
+
+public:
+    explicit StreamWriter(std::ostream &target) : out(target) {
+    }
+
+    void writeBytes(const void *data, size_t size) {
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    }
+
+    void writeByte(uint8_t byte) {
+        out.put(static_cast<char>(byte));
+    }
+};
+
+class StreamReader {
+private:
+    std::istream &in;
+
+public:
+    explicit StreamReader(std::istream &source) : in(source) {
+    }
+
+    void readBytes(void *data, size_t size) {
+        if (!in.read(static_cast<char *>(data), static_cast<std::streamsize>(size))) {
+            throw std::runtime_error("Unexpected end of binary data");
+        }
+    }
+
+    uint8_t readByte() {
+        int byte = in.get();
+        if (byte == std::istream::traits_type::eof()) {
+            throw std::runtime_error("Unexpected end of binary data");
+        }
+        return static_cast<uint8_t>(byte);
+    }
+};
+
+// LEB128: seven bits per byte, high bit set on every byte but the last.
+template<typename Writer>
+void writeVarint(Writer &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.writeByte(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.writeByte(static_cast<uint8_t>(value));
+}
+
+template<typename Reader>
+uint64_t readVarint(Reader &in) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = in.readByte();
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("Malformed varint in binary data");
+}
+
+// Encoding of a single item. Specialize for other element types with
+//   template<typename Writer> static void write(Writer &out, const T &value);
+//   template<typename Reader> static T read(Reader &in);
+template<typename T, typename Enable = void>
+struct BinaryCodec;
+
+// Integers as varints; signed values are zigzag-encoded so small negatives stay short.
+template<typename T>
+struct BinaryCodec<T, std::enable_if_t<std::is_integral_v<T> > > {
+    template<typename Writer>
+    static void write(Writer &out, T value) {
+        if constexpr (std::is_signed_v<T>) {
+            int64_t wide = value;
+            writeVarint(out, (static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+        } else {
+            writeVarint(out, value);
+        }
+    }
+
+    template<typename Reader>
+    static T read(Reader &in) {
+        uint64_t raw = readVarint(in);
+        if constexpr (std::is_signed_v<T>) {
+            return static_cast<T>(static_cast<int64_t>((raw >> 1) ^ (~(raw & 1) + 1)));
+        } else {
+            return static_cast<T>(raw);
+        }
+    }
+};
+
+// Floating point values as their raw bytes (host byte order), so they round-trip exactly.
+template<typename T>
+struct BinaryCodec<T, std::enable_if_t<std::is_floating_point_v<T> > > {
+    template<typename Writer>
+    static void write(Writer &out, T value) {
+        out.writeBytes(&value, sizeof(T));
+    }
+
+    template<typename Reader>
+    static T read(Reader &in) {
+        T value;
+        in.readBytes(&value, sizeof(T));
+        return value;
+    }
+};
+
+template<>
+struct BinaryCodec<std::string> {
+    template<typename Writer>
+    static void write(Writer &out, const std::string &value) {
+        writeVarint(out, value.size());
+        out.writeBytes(value.data(), value.size());
+    }
+
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+
+    // The length comes from the input, so it is checked before anything is allocated: against the
+    // bytes left when the reader knows them, otherwise by growing the string a chunk at a time so a
+    // corrupt length runs into the end of the data instead of a huge allocation.
+    template<typename Reader>
+    static std::string read(Reader &in) {
+        uint64_t size = readVarint(in);
+        std::string value;
+        if constexpr (requires { in.remaining(); }) {
+            if (size > in.remaining()) {
+                throw std::runtime_error("Unexpected end of binary data");
+            }
+            value.resize(size);
+            in.readBytes(value.data(), value.size());
+        } else {
+            if (size > value.max_size()) {
+                throw std::runtime_error("Malformed string length in binary data");
+            }
+            while (value.size() < size) {
+                size_t offset = value.size();
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - offset, READ_CHUNK));
+                value.resize(offset + chunk);
+                in.readBytes(value.data() + offset, chunk);
+            }
+        }
+        return value;
+    }
+};
+
+#endif
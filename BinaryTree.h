@@ -12,75 +12,537 @@
 #include <memory>
 #include <algorithm>
 #include "Sequences.h"
+#include "NodeAllocator.h"
+#include "ThreadPool.h"
+#include "BinaryCodec.h"
+#include "FrozenTree.h"
+#include "Visitor.h"
 #include <complex>
+#include <type_traits>
+#include <iterator>
+#include <cstddef>
+#include <compare>
+#include <concepts>
+#include <utility>
+
+// Balancing policies for BinaryTree<T, Balance>.
+struct NoBalancing {
+};
+
+// Left-leaning red-black tree (2-3 variant): O(log n) insert, remove and lookup.
+struct RedBlackBalancing {
+};
+
+// AVL tree: stores subtree heights and rotates on insert and remove, height stays below 1.44 log n.
+struct AVLBalancing {
+};
+
+// Adds subtree sizes to the nodes of any balancing policy, enabling kth() and rank() in O(height),
+// e.g. BinaryTree<int, OrderStatistics<AVLBalancing> >.
+template<typename Balance = NoBalancing>
+struct OrderStatistics {
+};
+
+template<typename Balance>
+struct BalancingTraits {
+    using Base = Balance;
+    static constexpr bool tracksSubtreeSize = false;
+};
+
+template<typename Balance>
+struct BalancingTraits<OrderStatistics<Balance> > {
+    using Base = Balance;
+    static constexpr bool tracksSubtreeSize = true;
+};
+
+// Comparison policies for BinaryTree<T, Balance, Allocator, Compare>. A comparator returns either a
+// three-way result (an ordering from <=> or a signed number), costing one call per level, or a
+// bool like std::less, in which case items that are not less are compared a second time.
 
-template<typename T>
+// Uses operator<=> when the items have one, operator< otherwise.
+struct ThreeWayCompare {
+    template<typename A, typename B>
+    auto operator()(const A &a, const B &b) const {
+        if constexpr (std::three_way_comparable_with<A, B>) {
+            return a <=> b;
+        } else {
+            return a < b;
+        }
+    }
+};
+
+// Orders items by a key read from them, e.g. BinaryTree<Student, NoBalancing, HeapNodeAllocator,
+// CompareBy<&Student::GetAverageGrade> >. Key may be a getter, a data member pointer or a function.
+// The tree can also look items up by the key alone, see find(const Key &).
+template<auto Key, typename Compare = ThreeWayCompare>
+struct CompareBy {
+    using KeyCompare = Compare;
+
+    template<typename T>
+    static decltype(auto) keyOf(const T &item) {
+        return std::invoke(Key, item);
+    }
+
+    template<typename T>
+    auto operator()(const T &a, const T &b) const {
+        return Compare{}(keyOf(a), keyOf(b));
+    }
+};
+
+template<typename T, typename Balance = NoBalancing, typename Allocator = HeapNodeAllocator,
+    typename Compare = ThreeWayCompare>
 class BinaryTree {
 private:
+    using BaseBalancing = typename BalancingTraits<Balance>::Base;
+
+    static constexpr bool isRedBlack = std::is_same_v<BaseBalancing, RedBlackBalancing>;
+    static constexpr bool isAVL = std::is_same_v<BaseBalancing, AVLBalancing>;
+    static constexpr bool isSelfBalancing = isRedBlack || isAVL;
+    static constexpr bool tracksSubtreeSize = BalancingTraits<Balance>::tracksSubtreeSize;
+
+    static constexpr int BLACK = 0;
+    static constexpr int RED = 1;
+
+    // Whether items can be looked up by a Key alone, which CompareBy allows for its key type.
+    template<typename Key>
+    static constexpr bool isKeyOf = requires(const T &item) {
+        typename Compare::KeyCompare;
+        requires std::is_same_v<std::remove_cvref_t<decltype(Compare::keyOf(item))>, Key>;
+    };
+
+    struct NoSubtreeSize {
+        NoSubtreeSize(size_t) {
+        }
+    };
+
     struct Node {
         T data;
+        int tag; // colour for red-black trees, subtree height for AVL trees
+        [[no_unique_address]] std::conditional_t<tracksSubtreeSize, size_t, NoSubtreeSize> subtreeSize;
         Node *left;
         Node *right;
 
-        Node(const T &item) : data(item), left(nullptr), right(nullptr) {
+        template<typename... Args>
+        explicit Node(Args &&... args)
+            : data(std::forward<Args>(args)...), tag(RED), subtreeSize(1), left(nullptr), right(nullptr) {
         }
     };
 
+    [[no_unique_address]] Allocator allocator;
+    [[no_unique_address]] Compare compare;
     Node *root;
+    size_t nodeCount;
+
+    // Constructs the item in place from the arguments; rvalues are moved, never copied.
+    template<typename... Args>
+    Node *createNode(Args &&... args) {
+        void *memory = allocator.allocate(sizeof(Node));
+        try {
+            Node *node = new(memory) Node(std::forward<Args>(args)...);
+            nodeCount++;
+            return node;
+        } catch (...) {
+            allocator.deallocate(memory, sizeof(Node));
+            throw;
+        }
+    }
 
-    void deleteTree(Node *node) {
-        if (node) {
-            deleteTree(node->left);
-            deleteTree(node->right);
-            delete node;
+    void destroyNode(Node *node) {
+        node->~Node();
+        allocator.deallocate(node, sizeof(Node));
+        nodeCount--;
+    }
+
+    // Frees every node; arenas holding trivially destructible items are released without a walk.
+    void clear() {
+        if constexpr (!(Allocator::releasesInBulk && std::is_trivially_destructible_v<T>)) {
+            deleteTree(root);
         }
+        allocator.release();
+        root = nullptr;
+        nodeCount = 0;
     }
 
-    Node *copyTree(Node *node) {
-        if (!node) return nullptr;
+    static bool isRed(Node *node) {
+        return node && node->tag == RED;
+    }
 
-        Node *newNode = new Node(node->data);
-        newNode->left = copyTree(node->left);
-        newNode->right = copyTree(node->right);
+    static int height(Node *node) {
+        return node ? node->tag : 0;
+    }
 
-        return newNode;
+    static size_t subtreeSizeOf(Node *node) {
+        return node ? node->subtreeSize : 0;
     }
 
-    Node *insertNode(Node *node, const T &item) {
-        if (!node) return new Node(item);
+    // Recomputes the bookkeeping of a node from its children.
+    static void update(Node *node) {
+        if constexpr (isAVL) {
+            node->tag = 1 + std::max(height(node->left), height(node->right));
+        }
+        if constexpr (tracksSubtreeSize) {
+            node->subtreeSize = 1 + subtreeSizeOf(node->left) + subtreeSizeOf(node->right);
+        }
+    }
 
-        if (compareItems(item, node->data) < 0) {
-            node->left = insertNode(node->left, item);
-        } else if (compareItems(item, node->data) > 0) {
-            node->right = insertNode(node->right, item);
+    static void copyBookkeeping(Node *target, Node *source) {
+        target->tag = source->tag;
+        target->subtreeSize = source->subtreeSize;
+    }
+
+    // Adjusts subtree sizes on the path from the root down to (not including) the node holding item.
+    template<typename Lookup>
+    void resizePath(const Lookup &item, bool grow) {
+        Node *node = root;
+        while (node) {
+            int compResult = compareItems(item, node->data);
+            if (compResult == 0) return;
+            if (grow) {
+                node->subtreeSize++;
+            } else {
+                node->subtreeSize--;
+            }
+            node = compResult < 0 ? node->left : node->right;
+        }
+    }
+
+    static Node *rotateLeft(Node *node) {
+        Node *pivot = node->right;
+        node->right = pivot->left;
+        pivot->left = node;
+        if constexpr (isRedBlack) {
+            pivot->tag = node->tag;
+            node->tag = RED;
+        }
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    static Node *rotateRight(Node *node) {
+        Node *pivot = node->left;
+        node->left = pivot->right;
+        pivot->right = node;
+        if constexpr (isRedBlack) {
+            pivot->tag = node->tag;
+            node->tag = RED;
+        }
+        update(node);
+        update(pivot);
+        return pivot;
+    }
+
+    static Node *rebalanceAVL(Node *node) {
+        update(node);
+        int balanceFactor = height(node->left) - height(node->right);
+
+        if (balanceFactor > 1) {
+            if (height(node->left->left) < height(node->left->right)) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+        if (balanceFactor < -1) {
+            if (height(node->right->right) < height(node->right->left)) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+
+        return node;
+    }
+
+    static void flipColors(Node *node) {
+        node->tag = !node->tag;
+        node->left->tag = !node->left->tag;
+        node->right->tag = !node->right->tag;
+    }
+
+    static Node *fixUpRedBlack(Node *node) {
+        update(node);
+        if (isRed(node->right) && !isRed(node->left)) node = rotateLeft(node);
+        if (isRed(node->left) && isRed(node->left->left)) node = rotateRight(node);
+        if (isRed(node->left) && isRed(node->right)) flipColors(node);
+        return node;
+    }
+
+    static Node *moveRedLeft(Node *node) {
+        flipColors(node);
+        if (isRed(node->right->left)) {
+            node->right = rotateRight(node->right);
+            node = rotateLeft(node);
+            flipColors(node);
         }
+        return node;
+    }
 
+    static Node *moveRedRight(Node *node) {
+        flipColors(node);
+        if (isRed(node->left->left)) {
+            node = rotateRight(node);
+            flipColors(node);
+        }
         return node;
     }
 
-    Node *findNode(Node *node, const T &item) const {
+    // Walks the tree in the order given by a format string over K (key), L (left) and P (right),
+    // calling visit for every node and visitNull for every empty link. The explicit stack keeps
+    // degenerate trees from overflowing the call stack, and visit can stop the walk (see proceed()).
+    // The format is read again at every node, so the fixed orders use the loops below instead and this
+    // is kept for custom orders and serialization.
+    template<typename Visit, typename VisitNull>
+    void walk(Node *node, const std::string &format, Visit &&visit, VisitNull &&visitNull) const {
+        struct Frame {
+            Node *node;
+            size_t step;
+        };
+
+        std::vector<Frame> stack;
+        auto enter = [&](Node *next) {
+            if (next) {
+                stack.push_back({next, 0});
+            } else {
+                visitNull();
+            }
+        };
+
+        enter(node);
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.step == format.size()) {
+                stack.pop_back();
+                continue;
+            }
+
+            Node *current = frame.node;
+            char c = format[frame.step++];
+            if (c == 'K' || c == 'k') {
+                if (!proceed(visit, current)) return;
+            } else if (c == 'L' || c == 'l') {
+                enter(current->left);
+            } else if (c == 'P' || c == 'p') {
+                enter(current->right);
+            }
+        }
+    }
+
+    template<typename Visit>
+    void walk(Node *node, const std::string &format, Visit &&visit) const {
+        walk(node, format, visit, [] {
+        });
+    }
+
+    // The fixed-order walks: LKP, KLP and LPK, or PKL, KPL and PLK when Mirrored swaps the children.
+    template<bool Mirrored>
+    static Node *firstChild(Node *node) {
+        return Mirrored ? node->right : node->left;
+    }
+
+    template<bool Mirrored>
+    static Node *secondChild(Node *node) {
+        return Mirrored ? node->left : node->right;
+    }
+
+    template<bool Mirrored = false, typename Visit>
+    void walkInOrder(Node *node, Visit &&visit) const {
+        std::vector<Node *> stack;
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = firstChild<Mirrored>(node);
+            }
+            node = stack.back();
+            stack.pop_back();
+            if (!proceed(visit, node)) return;
+            node = secondChild<Mirrored>(node);
+        }
+    }
+
+    template<bool Mirrored = false, typename Visit>
+    void walkPreOrder(Node *node, Visit &&visit) const {
+        std::vector<Node *> stack;
+        while (true) {
+            while (node) {
+                if (!proceed(visit, node)) return;
+                if (Node *second = secondChild<Mirrored>(node)) stack.push_back(second);
+                node = firstChild<Mirrored>(node);
+            }
+            if (stack.empty()) return;
+            node = stack.back();
+            stack.pop_back();
+        }
+    }
+
+    template<bool Mirrored = false, typename Visit>
+    void walkPostOrder(Node *node, Visit &&visit) const {
+        std::vector<Node *> stack;
+        Node *last = nullptr;
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = firstChild<Mirrored>(node);
+            }
+            Node *top = stack.back();
+            Node *second = secondChild<Mirrored>(top);
+            if (second && second != last) {
+                node = second;
+            } else {
+                stack.pop_back();
+                if (!proceed(visit, top)) return;
+                last = top;
+            }
+        }
+    }
+
+    void deleteTree(Node *node) {
+        std::vector<Node *> stack;
+        if (node) stack.push_back(node);
+        while (!stack.empty()) {
+            Node *current = stack.back();
+            stack.pop_back();
+            if (current->left) stack.push_back(current->left);
+            if (current->right) stack.push_back(current->right);
+            destroyNode(current);
+        }
+    }
+
+    // Copies the shape of a subtree, storing transform(data) in every new node.
+    template<typename Transform>
+    Node *copyTree(Node *node, Transform &&transform) {
         if (!node) return nullptr;
 
+        Node *copy = createNode(transform(node->data));
+        copyBookkeeping(copy, node);
+
+        // The copy stays a linked tree throughout, so a throwing transform leaves nothing behind.
+        try {
+            std::vector<std::pair<Node *, Node *> > stack;
+            stack.push_back({node, copy});
+            while (!stack.empty()) {
+                auto [source, target] = stack.back();
+                stack.pop_back();
+
+                if (source->left) {
+                    target->left = createNode(transform(source->left->data));
+                    copyBookkeeping(target->left, source->left);
+                    stack.push_back({source->left, target->left});
+                }
+                if (source->right) {
+                    target->right = createNode(transform(source->right->data));
+                    copyBookkeeping(target->right, source->right);
+                    stack.push_back({source->right, target->right});
+                }
+            }
+        } catch (...) {
+            deleteTree(copy);
+            throw;
+        }
+
+        return copy;
+    }
+
+    Node *copyTree(Node *node) {
+        return copyTree(node, [](const T &item) -> const T & {
+            return item;
+        });
+    }
+
+    // Link that holds the item, or the empty link where it would be inserted. The descent only
+    // tracks the parent and the direction taken, so it compiles to conditional moves like findNode
+    // instead of a hard-to-predict branch per level.
+    template<typename Lookup>
+    Node **findLink(const Lookup &item) {
+        Node *parent = nullptr;
+        Node *node = root;
+        bool toRight = false;
+        while (node) {
+            int compResult = compareItems(item, node->data);
+            if (compResult == 0) break;
+            parent = node;
+            toRight = compResult > 0;
+            node = toRight ? node->right : node->left;
+        }
+        if (!parent) return &root;
+        return toRight ? &parent->right : &parent->left;
+    }
+
+    // make() creates the new node once the item is known to be missing, so nothing is built
+    // (or moved from) for duplicates. stored receives the node holding the item afterwards.
+    template<typename Lookup, typename Make>
+    Node *insertNode(Node *node, const Lookup &item, Make &make, Node *&stored) {
+        if (!node) return stored = make();
+
         int compResult = compareItems(item, node->data);
-        if (compResult == 0) {
-            return node;
-        } else if (compResult < 0) {
-            return findNode(node->left, item);
+        if (compResult < 0) {
+            node->left = insertNode(node->left, item, make, stored);
+        } else if (compResult > 0) {
+            node->right = insertNode(node->right, item, make, stored);
+        } else {
+            stored = node;
+        }
+
+        if constexpr (isRedBlack) {
+            node = fixUpRedBlack(node);
+        } else if constexpr (isAVL) {
+            node = rebalanceAVL(node);
+        }
+
+        return node;
+    }
+
+    // Node holding the item, and whether make() had to create it.
+    template<typename Lookup, typename Make>
+    std::pair<Node *, bool> insertWith(const Lookup &item, Make &&make) {
+        Node *stored = nullptr;
+        bool inserted = false;
+        auto create = [&] {
+            inserted = true;
+            return make();
+        };
+
+        if constexpr (isSelfBalancing) {
+            root = insertNode(root, item, create, stored);
+            if constexpr (isRedBlack) {
+                root->tag = BLACK;
+            }
         } else {
-            return findNode(node->right, item);
+            Node **link = findLink(item);
+            if (!*link) {
+                *link = create();
+                if constexpr (tracksSubtreeSize) {
+                    resizePath((*link)->data, true);
+                }
+            }
+            stored = *link;
         }
+        return {stored, inserted};
     }
 
-    Node *findMinNode(Node *node) const {
-        if (!node) return nullptr;
+    template<typename Lookup>
+    Node *findNode(Node *node, const Lookup &item) const {
+        while (node) {
+            int compResult = compareItems(item, node->data);
+            if (compResult == 0) {
+                return node;
+            }
+            node = compResult < 0 ? node->left : node->right;
+        }
+        return nullptr;
+    }
 
-        while (node->left) {
-            node = node->left;
+    // Unlinks the leftmost node of an AVL subtree without freeing it and returns the rebalanced rest.
+    static Node *detachMin(Node *node, Node *&minimum) {
+        if (!node->left) {
+            minimum = node;
+            return node->right;
         }
-        return node;
+
+        node->left = detachMin(node->left, minimum);
+        return rebalanceAVL(node);
     }
 
-    Node *deleteNode(Node *node, const T &item) {
+    template<typename Lookup>
+    Node *deleteNode(Node *node, const Lookup &item) {
         if (!node) return nullptr;
 
         int compResult = compareItems(item, node->data);
@@ -91,385 +553,1427 @@ private:
         } else {
             if (!node->left) {
                 Node *temp = node->right;
-                delete node;
+                destroyNode(node);
                 return temp;
             } else if (!node->right) {
                 Node *temp = node->left;
-                delete node;
+                destroyNode(node);
                 return temp;
             }
 
-            Node *temp = findMinNode(node->right);
-            node->data = temp->data;
-            node->right = deleteNode(node->right, temp->data);
+            // The successor node takes the place of the removed one; no item is copied.
+            Node *successor = nullptr;
+            Node *right = detachMin(node->right, successor);
+            successor->left = node->left;
+            successor->right = right;
+            destroyNode(node);
+            node = successor;
+        }
+
+        if constexpr (isAVL) {
+            node = rebalanceAVL(node);
         }
 
         return node;
     }
 
-    Node *mapTree(Node *node, const std::function<T(const T &)> &func) const {
-        if (!node) return nullptr;
+    // Unlinks the leftmost node of a red-black subtree without freeing it.
+    static Node *detachMinRedBlack(Node *node, Node *&minimum) {
+        if (!node->left) {
+            minimum = node;
+            return nullptr;
+        }
 
-        Node *newNode = new Node(func(node->data));
-        newNode->left = mapTree(node->left, func);
-        newNode->right = mapTree(node->right, func);
+        if (!isRed(node->left) && !isRed(node->left->left)) node = moveRedLeft(node);
+        node->left = detachMinRedBlack(node->left, minimum);
 
-        return newNode;
+        return fixUpRedBlack(node);
     }
 
-    Node *whereTree(Node *node, const std::function<bool(const T &)> &predicate) const {
-        if (!node) return nullptr;
+    // Expects the item to be present in the subtree.
+    template<typename Lookup>
+    Node *deleteNodeRedBlack(Node *node, const Lookup &item) {
+        if (compareItems(item, node->data) < 0) {
+            if (!isRed(node->left) && !isRed(node->left->left)) node = moveRedLeft(node);
+            node->left = deleteNodeRedBlack(node->left, item);
+        } else {
+            if (isRed(node->left)) node = rotateRight(node);
+            if (compareItems(item, node->data) == 0 && !node->right) {
+                destroyNode(node);
+                return nullptr;
+            }
+            if (!isRed(node->right) && !isRed(node->right->left)) node = moveRedRight(node);
+            if (compareItems(item, node->data) == 0) {
+                Node *successor = nullptr;
+                Node *right = detachMinRedBlack(node->right, successor);
+                successor->left = node->left;
+                successor->right = right;
+                successor->tag = node->tag;
+                destroyNode(node);
+                node = successor;
+            } else {
+                node->right = deleteNodeRedBlack(node->right, item);
+            }
+        }
 
-        Node *resultNode = nullptr;
+        return fixUpRedBlack(node);
+    }
 
-        if (predicate(node->data)) {
-            resultNode = new Node(node->data);
-            resultNode->left = whereTree(node->left, predicate);
-            resultNode->right = whereTree(node->right, predicate);
+    // Removes the item equal to the lookup, which is an item or a key of one.
+    template<typename Lookup>
+    void removeItem(const Lookup &item) {
+        if constexpr (isRedBlack) {
+            if (!findNode(root, item)) return;
+            if (!isRed(root->left) && !isRed(root->right)) root->tag = RED;
+            root = deleteNodeRedBlack(root, item);
+            if (root) root->tag = BLACK;
+        } else if constexpr (isAVL) {
+            root = deleteNode(root, item);
         } else {
-            Node *leftResult = whereTree(node->left, predicate);
-            Node *rightResult = whereTree(node->right, predicate);
+            Node **link = findLink(item);
+            Node *node = *link;
+            if (!node) return;
 
-            if (leftResult || rightResult) {
-                resultNode = new Node(node->data);
-                resultNode->left = leftResult;
-                resultNode->right = rightResult;
+            if (!node->left || !node->right) {
+                if constexpr (tracksSubtreeSize) {
+                    resizePath(item, false);
+                }
+                *link = node->left ? node->left : node->right;
+                destroyNode(node);
+                return;
+            }
+
+            Node **successorLink = &node->right;
+            while ((*successorLink)->left) {
+                successorLink = &(*successorLink)->left;
+            }
+            // The successor node moves into the removed node's place; no item is copied.
+            Node *successor = *successorLink;
+            if constexpr (tracksSubtreeSize) {
+                resizePath(successor->data, false);
             }
+            *successorLink = successor->right;
+            successor->left = node->left;
+            successor->right = node->right;
+            copyBookkeeping(successor, node);
+            *link = successor;
+            destroyNode(node);
         }
+    }
 
-        return resultNode;
+    Node *mapTree(Node *node, const std::function<T(const T &)> &func) {
+        return copyTree(node, func);
     }
 
+    static constexpr bool isHashable = requires(const T &item) {
+        { std::hash<T>{}(item) } -> std::convertible_to<size_t>;
+    };
+
+    static constexpr size_t EMPTY_FINGERPRINT = 0x9e3779b97f4a7c15;
+
+    static size_t combineHashes(size_t seed, size_t value) {
+        return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+    }
+
+    // Merkle-style fingerprints: a node's fingerprint combines the hash of its item with those of
+    // its left and right subtrees, so equal subtrees get equal fingerprints. Computed bottom-up in
+    // one walk; visit(node, fingerprint, size) sees every subtree and can stop the walk with false.
+    template<typename Visit>
+    size_t fingerprintTree(Node *node, Visit &&visit) const {
+        if (!node) return EMPTY_FINGERPRINT;
+
+        std::vector<std::pair<size_t, size_t> > results;
+        auto childResult = [&](Node *child) -> std::pair<size_t, size_t> {
+            if (!child) return {EMPTY_FINGERPRINT, 0};
+            auto result = results.back();
+            results.pop_back();
+            return result;
+        };
+        walkPostOrder(node, [&](Node *current) {
+            auto [rightFingerprint, rightSize] = childResult(current->right);
+            auto [leftFingerprint, leftSize] = childResult(current->left);
+
+            size_t fingerprint = combineHashes(std::hash<T>{}(current->data), leftFingerprint);
+            fingerprint = combineHashes(fingerprint, rightFingerprint);
+            size_t size = 1 + leftSize + rightSize;
+            results.push_back({fingerprint, size});
+            return visit(current, fingerprint, size);
+        });
+        return results.back().first;
+    }
+
+    // A search for the subtree's root finds the only candidate in an ordered tree, which settles
+    // most hits in O(log n + m). Any miss then scans the whole tree, because map() can leave it
+    // unordered: with fingerprints only subtrees of the same fingerprint and size are compared node
+    // by node, O(n + m) instead of O(n * m).
     bool isSubtree(Node *mainTree, Node *subtree) const {
         if (!subtree) return true;
-        if (!mainTree) return false;
 
-        if (areIdentical(mainTree, subtree)) {
-            return true;
+        Node *candidate = findNode(mainTree, subtree->data);
+        if (candidate && areIdentical(candidate, subtree)) return true;
+
+        bool found = false;
+        if constexpr (isHashable) {
+            size_t subtreeSize = 0;
+            size_t subtreeFingerprint = fingerprintTree(subtree, [&](Node *, size_t, size_t size) {
+                subtreeSize = size;
+                return true;
+            });
+            fingerprintTree(mainTree, [&](Node *current, size_t fingerprint, size_t size) {
+                found = fingerprint == subtreeFingerprint && size == subtreeSize && areIdentical(current, subtree);
+                return !found;
+            });
+        } else {
+            walkPreOrder(mainTree, [&](Node *current) {
+                found = areIdentical(current, subtree);
+                return !found;
+            });
         }
-
-        return isSubtree(mainTree->left, subtree) || isSubtree(mainTree->right, subtree);
+        return found;
     }
 
     bool areIdentical(Node *a, Node *b) const {
-        if (!a && !b) return true;
-        if (!a || !b) return false;
+        std::vector<std::pair<Node *, Node *> > stack;
+        stack.push_back({a, b});
+        while (!stack.empty()) {
+            auto [first, second] = stack.back();
+            stack.pop_back();
 
-        return (a->data == b->data) &&
-               areIdentical(a->left, b->left) &&
-               areIdentical(a->right, b->right);
+            if (!first && !second) continue;
+            if (!first || !second || !(first->data == second->data)) return false;
+
+            stack.push_back({first->left, second->left});
+            stack.push_back({first->right, second->right});
+        }
+        return true;
     }
 
-    void traverseInOrder(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    static auto appendTo(std::vector<T> &result) {
+        return [&result](Node *current) {
+            result.push_back(current->data);
+        };
+    }
 
-        traverseInOrder(node->left, result);
-        result.push_back(node->data);
-        traverseInOrder(node->right, result);
+    void traverse(Node *node, std::vector<T> &result, const std::string &format) const {
+        walk(node, format, appendTo(result));
     }
 
-    void traversePreOrder(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // Emits one token at a time, so the output can go straight to a stream.
+    template<typename Append>
+    void serializeTree(Node *node, const std::string &format, Append &&append) const {
+        walk(node, format, [&](Node *current) {
+            append(std::to_string(current->data) + ",");
+        }, [&] {
+            append("null,");
+        });
+    }
+
+    // Links every node into the tree as soon as it is read, so a failed load leaves nothing dangling.
+    void deserializeTree(std::istream &in, const std::string &format, Node *&target) {
+        std::string val;
+        auto readNode = [&]() -> Node * {
+            if (!std::getline(in, val, ',')) return nullptr;
+            if (val == "null") return nullptr;
+            return createNode(static_cast<T>(std::stoi(val)));
+        };
+
+        struct Frame {
+            Node *node;
+            size_t step;
+        };
+
+        Node *node = target = readNode();
+        std::vector<Frame> stack;
+        if (node) stack.push_back({node, 0});
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.step == format.size()) {
+                stack.pop_back();
+                continue;
+            }
 
-        result.push_back(node->data);
-        traversePreOrder(node->left, result);
-        traversePreOrder(node->right, result);
+            Node *current = frame.node;
+            char c = format[frame.step++];
+            Node *child = nullptr;
+            if (c == 'L' || c == 'l') {
+                child = current->left = readNode();
+            } else if (c == 'P' || c == 'p') {
+                child = current->right = readNode();
+            }
+            if (child) stack.push_back({child, 0});
+        }
     }
 
-    void traversePostOrder(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // Binary snapshot: "BTRE", format version, varint item count, then the items in pre-order in
+    // groups of four, each group preceded by a shape byte holding two bits per node (has left,
+    // has right child).
+    static constexpr char BINARY_MAGIC[4] = {'B', 'T', 'R', 'E'};
+    static constexpr uint8_t BINARY_VERSION = 1;
+
+    template<typename Writer>
+    void writeBinary(Writer &out) const {
+        out.writeBytes(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        out.writeByte(BINARY_VERSION);
+        writeVarint(out, nodeCount);
+
+        Node *group[4];
+        size_t grouped = 0;
+        uint8_t shape = 0;
+        auto flush = [&] {
+            out.writeByte(shape);
+            for (size_t i = 0; i < grouped; i++) {
+                BinaryCodec<T>::write(out, group[i]->data);
+            }
+            grouped = 0;
+            shape = 0;
+        };
+
+        walkPreOrder(root, [&](Node *current) {
+            shape |= static_cast<uint8_t>((current->left ? 1 : 0) | (current->right ? 2 : 0)) << (2 * grouped);
+            group[grouped++] = current;
+            if (grouped == 4) flush();
+        });
+        if (grouped) flush();
+    }
+
+    template<typename Reader>
+    void readBinary(Reader &in) {
+        clear();
+        char magic[sizeof(BINARY_MAGIC)];
+        in.readBytes(magic, sizeof(magic));
+        if (!std::equal(magic, magic + sizeof(magic), BINARY_MAGIC)) {
+            throw std::runtime_error("Not a binary tree snapshot");
+        }
+        if (in.readByte() != BINARY_VERSION) {
+            throw std::runtime_error("Unsupported binary tree snapshot version");
+        }
 
-        traversePostOrder(node->left, result);
-        traversePostOrder(node->right, result);
-        result.push_back(node->data);
+        // Nodes are linked in as soon as they are read, so clear() frees everything on failure.
+        try {
+            uint64_t count = readVarint(in);
+            std::vector<Node **> links = {&root};
+            uint8_t shape = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                if (links.empty()) {
+                    throw std::runtime_error("Malformed binary tree snapshot");
+                }
+                if (i % 4 == 0) shape = in.readByte();
+
+                Node **link = links.back();
+                links.pop_back();
+                *link = createNode(BinaryCodec<T>::read(in));
+
+                uint8_t children = shape >> (2 * (i % 4));
+                if (children & 2) links.push_back(&(*link)->right);
+                if (children & 1) links.push_back(&(*link)->left);
+            }
+            if (count ? !links.empty() : links.size() != 1) {
+                throw std::runtime_error("Malformed binary tree snapshot");
+            }
+        } catch (...) {
+            clear();
+            throw;
+        }
+        restoreInvariants();
     }
 
-    void traverseKLP(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // Re-establishes balance and bookkeeping after nodes were linked in by a loader.
+    void restoreInvariants() {
+        if constexpr (isSelfBalancing) {
+            balance();
+        } else if constexpr (tracksSubtreeSize) {
+            walkPostOrder(root, update);
+        }
+    }
 
-        result.push_back(node->data);
-        traverseKLP(node->left, result);
-        traverseKLP(node->right, result);
+    Node *extractSubtree(Node *node, const T &rootValue) {
+        Node *match = nullptr;
+        walkPreOrder(node, [&](Node *current) {
+            if (current->data == rootValue) match = current;
+            return match == nullptr;
+        });
+        return copyTree(match);
     }
 
-    void traverseKPL(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // The builders take their nodes from make(i), which returns a childless node for the i-th item
+    // in sorted order, so the same code builds from values and relinks existing nodes.
+    template<typename Make>
+    Node *balanceTree(Make &make, int start, int end) {
+        if (start > end) return nullptr;
 
-        result.push_back(node->data);
-        traverseKPL(node->right, result);
-        traverseKPL(node->left, result);
+        int mid = start + (end - start) / 2;
+        Node *node = make(mid);
+
+        node->left = balanceTree(make, start, mid - 1);
+        node->right = balanceTree(make, mid + 1, end);
+        update(node);
+
+        return node;
     }
 
-    void traverseLPK(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // Builds a 2-3 tree of the given black height from count sorted items: 2^h - 1 <= count <= 3^h - 1.
+    // Each level is a 2-node (one black key) or, when that cannot hold the items, a 3-node
+    // (black key with a red left child).
+    template<typename Make>
+    Node *balanceTreeRedBlack(Make &make, int start, int count, int blackHeight) {
+        if (count == 0) return nullptr;
+
+        long long childCapacity = 1;
+        for (int i = 1; i < blackHeight; i++) childCapacity *= 3;
+        childCapacity -= 1;
+
+        if (count - 1 <= 2 * childCapacity) {
+            int leftCount = (count - 1) / 2;
+            Node *node = make(start + leftCount);
+            node->tag = BLACK;
+            node->left = balanceTreeRedBlack(make, start, leftCount, blackHeight - 1);
+            node->right = balanceTreeRedBlack(make, start + leftCount + 1, count - 1 - leftCount,
+                                            blackHeight - 1);
+            update(node);
+            return node;
+        }
+
+        int firstCount = (count - 2) / 3;
+        int secondCount = (count - 2 - firstCount) / 2;
+        int thirdCount = count - 2 - firstCount - secondCount;
 
-        traverseLPK(node->left, result);
-        traverseLPK(node->right, result);
-        result.push_back(node->data);
+        Node *red = make(start + firstCount);
+        red->left = balanceTreeRedBlack(make, start, firstCount, blackHeight - 1);
+        red->right = balanceTreeRedBlack(make, start + firstCount + 1, secondCount, blackHeight - 1);
+        update(red);
+
+        Node *node = make(start + firstCount + secondCount + 1);
+        node->tag = BLACK;
+        node->left = red;
+        node->right = balanceTreeRedBlack(make, start + count - thirdCount, thirdCount, blackHeight - 1);
+        update(node);
+        return node;
     }
 
-    void traverseLKP(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    template<typename Make>
+    Node *buildBalanced(Make &make, size_t count) {
+        if constexpr (isRedBlack) {
+            int blackHeight = 0;
+            while ((size_t(1) << (blackHeight + 1)) - 1 <= count) blackHeight++;
+            return balanceTreeRedBlack(make, 0, count, blackHeight);
+        } else {
+            return balanceTree(make, 0, static_cast<int>(count) - 1);
+        }
+    }
 
-        traverseLKP(node->left, result);
-        result.push_back(node->data);
-        traverseLKP(node->right, result);
+    // Moves the items out of the array into the new nodes.
+    Node *buildBalanced(std::vector<T> &sortedArray) {
+        auto make = [&](int index) {
+            return createNode(std::move(sortedArray[index]));
+        };
+        return buildBalanced(make, sortedArray.size());
     }
 
-    void traversePLK(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    // Rebuilds existing nodes, given in sorted order, into a balanced tree.
+    Node *relinkBalanced(std::vector<Node *> &sortedNodes) {
+        auto make = [&](int index) {
+            Node *node = sortedNodes[index];
+            node->left = node->right = nullptr;
+            node->tag = RED;
+            node->subtreeSize = 1;
+            return node;
+        };
+        return buildBalanced(make, sortedNodes.size());
+    }
+
+    // A detached subtree. blackHeight counts the black nodes on any path down from its root and is
+    // only kept for red-black trees; AVL trees read their heights from the nodes.
+    struct Part {
+        Node *node;
+        int blackHeight;
+    };
 
-        traversePLK(node->right, result);
-        traversePLK(node->left, result);
-        result.push_back(node->data);
+    static int blackHeight(Node *node) {
+        int result = 0;
+        for (; node; node = node->left) {
+            if (!isRed(node)) result++;
+        }
+        return result;
     }
 
-    void traversePKL(Node *node, std::vector<T> &result) const {
-        if (!node) return;
+    static void blacken(Part &part) {
+        if (isRedBlack && isRed(part.node)) {
+            part.node->tag = BLACK;
+            part.blackHeight++;
+        }
+    }
+
+    // Hangs middle between left and right at the spine level where their heights meet, then
+    // rebalances back up: O(height difference).
+    static Node *joinAVL(Node *left, Node *middle, Node *right) {
+        if (height(left) > height(right) + 1) {
+            left->right = joinAVL(left->right, middle, right);
+            return rebalanceAVL(left);
+        }
+        if (height(right) > height(left) + 1) {
+            right->left = joinAVL(left, middle, right->left);
+            return rebalanceAVL(right);
+        }
 
-        traversePKL(node->right, result);
-        result.push_back(node->data);
-        traversePKL(node->left, result);
+        middle->left = left;
+        middle->right = right;
+        update(middle);
+        return middle;
     }
 
-    void serializeTree(Node *node, std::string &result, const std::string &format) const {
-        if (!node) {
-            result += "null,";
-            return;
+    // Same for red-black trees by black height: middle goes in as a red node over two black
+    // subtrees of equal black height, which the usual insertion fix-up repairs on the way up.
+    static Node *joinRedBlack(Node *left, int leftHeight, Node *middle, Node *right, int rightHeight) {
+        if (leftHeight > rightHeight) {
+            left->right = joinRedBlack(left->right, leftHeight - 1, middle, right, rightHeight);
+            return fixUpRedBlack(left);
+        }
+        if (rightHeight > leftHeight || isRed(right)) {
+            right->left = joinRedBlack(left, leftHeight, middle, right->left, rightHeight - !isRed(right));
+            return fixUpRedBlack(right);
         }
 
-        for (size_t i = 0; i < format.size(); i++) {
-            char c = format[i];
-            if (c == 'K' || c == 'k') {
-                result += std::to_string(node->data) + ",";
-            } else if (c == 'L' || c == 'l') {
-                serializeTree(node->left, result, format);
-            } else if (c == 'P' || c == 'p') {
-                serializeTree(node->right, result, format);
-            }
+        middle->left = left;
+        middle->right = right;
+        middle->tag = RED;
+        update(middle);
+        return middle;
+    }
+
+    // Joins two subtrees around a middle node; every item of left is smaller than middle and every
+    // item of right is greater. Unbalanced trees just put middle on top.
+    static Part joinTrees(Part left, Node *middle, Part right) {
+        if constexpr (isRedBlack) {
+            blacken(left);
+            blacken(right);
+            Part joined{joinRedBlack(left.node, left.blackHeight, middle, right.node, right.blackHeight),
+                        std::max(left.blackHeight, right.blackHeight)};
+            blacken(joined);
+            return joined;
+        } else if constexpr (isAVL) {
+            return {joinAVL(left.node, middle, right.node), 0};
+        } else {
+            middle->left = left.node;
+            middle->right = right.node;
+            update(middle);
+            return {middle, 0};
         }
     }
 
-    Node *deserializeTree(std::istringstream &iss, const std::string &format) {
-        std::string val;
-        if (!std::getline(iss, val, ',')) return nullptr;
+    // Joins two subtrees without a middle node, taking the smallest item of right in its place.
+    static Part concatenate(Part left, Part right) {
+        if (!left.node) return right;
+        if (!right.node) return left;
+        blacken(left);
+        blacken(right);
+
+        if constexpr (isSelfBalancing) {
+            Node *middle = nullptr;
+            if constexpr (isRedBlack) {
+                if (!isRed(right.node->left) && !isRed(right.node->right)) right.node->tag = RED;
+                right.node = detachMinRedBlack(right.node, middle);
+                if (right.node) right.node->tag = BLACK;
+                right.blackHeight = blackHeight(right.node);
+            } else {
+                right.node = detachMin(right.node, middle);
+            }
+            return joinTrees(left, middle, right);
+        } else {
+            Node *last = left.node;
+            while (true) {
+                if constexpr (tracksSubtreeSize) {
+                    last->subtreeSize += right.node->subtreeSize;
+                }
+                if (!last->right) break;
+                last = last->right;
+            }
+            last->right = right.node;
+            return left;
+        }
+    }
 
-        if (val == "null") return nullptr;
+    // Splits a subtree into the items less than and greater than key, rejoining the subtrees
+    // left over along the search path from the bottom up. The node equal to key, if any, ends up
+    // in match. O(log n) on self-balancing trees, since the joins along the path telescope.
+    void splitTree(Part part, const T &key, Part &less, Part &greater, Node *&match) {
+        std::vector<Part> path;
+        match = nullptr;
+        while (part.node) {
+            Node *node = part.node;
+            int compResult = compareItems(key, node->data);
+            int childHeight = part.blackHeight - !isRed(node);
+            if (compResult == 0) {
+                match = node;
+                less = {node->left, childHeight};
+                greater = {node->right, childHeight};
+                break;
+            }
+            path.push_back(part);
+            part = {compResult < 0 ? node->left : node->right, childHeight};
+        }
+        if (!match) {
+            less = greater = {nullptr, 0};
+        }
 
-        Node *node = new Node(static_cast<T>(std::stoi(val)));
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            Node *node = it->node;
+            int childHeight = it->blackHeight - !isRed(node);
+            if (compareItems(key, node->data) < 0) {
+                greater = joinTrees(greater, node, {node->right, childHeight});
+            } else {
+                less = joinTrees({node->left, childHeight}, node, less);
+            }
+        }
+    }
 
-        for (size_t i = 0; i < format.size(); i++) {
-            char c = format[i];
-            if (c == 'L' || c == 'l') {
-                node->left = deserializeTree(iss, format);
-            } else if (c == 'P' || c == 'p') {
-                node->right = deserializeTree(iss, format);
+    // Size of the first of two subtrees holding total nodes together. Both are walked in step until
+    // one ends, so only the smaller one is counted: O(min(first, second)), O(1) with subtree sizes.
+    size_t countFirst(Node *first, Node *second, size_t total) const {
+        if constexpr (tracksSubtreeSize) {
+            return subtreeSizeOf(first);
+        } else {
+            std::vector<Node *> firstStack, secondStack;
+            if (first) firstStack.push_back(first);
+            if (second) secondStack.push_back(second);
+            size_t firstCount = 0, secondCount = 0;
+            auto step = [](std::vector<Node *> &stack, size_t &count) {
+                Node *node = stack.back();
+                stack.pop_back();
+                if (node->left) stack.push_back(node->left);
+                if (node->right) stack.push_back(node->right);
+                count++;
+            };
+            while (true) {
+                if (firstStack.empty()) return firstCount;
+                if (secondStack.empty()) return total - secondCount;
+                step(firstStack, firstCount);
+                step(secondStack, secondCount);
             }
         }
+    }
 
-        return node;
+    Part rootPart() const {
+        if constexpr (isRedBlack) {
+            return {root, blackHeight(root)};
+        } else {
+            return {root, 0};
+        }
     }
 
-    Node *extractSubtree(Node *node, const T &rootValue) const {
-        if (!node) return nullptr;
+public:
+    // Bidirectional in-order iterator. Keeps the path from the root to the current node,
+    // so no element is copied and a scan can stop at any point.
+    class InOrderIterator {
+    private:
+        Node *root;
+        std::vector<Node *> path;
+
+        void descendLeft(Node *node) {
+            while (node) {
+                path.push_back(node);
+                node = node->left;
+            }
+        }
 
-        if (node->data == rootValue) {
-            Node *newNode = new Node(node->data);
-            if (node->left) {
-                newNode->left = new Node(node->left->data);
-                if (node->left->left) {
-                    Node *tempLeft = copySubtree(node->left->left);
-                    newNode->left->left = tempLeft;
-                }
-                if (node->left->right) {
-                    Node *tempRight = copySubtree(node->left->right);
-                    newNode->left->right = tempRight;
-                }
+        void descendRight(Node *node) {
+            while (node) {
+                path.push_back(node);
+                node = node->right;
             }
+        }
+
+        friend class BinaryTree;
+
+        InOrderIterator(Node *treeRoot, bool atEnd) : root(treeRoot) {
+            if (!atEnd) descendLeft(root);
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        InOrderIterator() : root(nullptr) {
+        }
+
+        reference operator*() const {
+            return path.back()->data;
+        }
+
+        pointer operator->() const {
+            return &path.back()->data;
+        }
+
+        InOrderIterator &operator++() {
+            Node *node = path.back();
             if (node->right) {
-                newNode->right = new Node(node->right->data);
-                if (node->right->left) {
-                    Node *tempLeft = copySubtree(node->right->left);
-                    newNode->right->left = tempLeft;
+                descendLeft(node->right);
+            } else {
+                Node *child;
+                do {
+                    child = path.back();
+                    path.pop_back();
+                } while (!path.empty() && path.back()->right == child);
+            }
+            return *this;
+        }
+
+        InOrderIterator operator++(int) {
+            InOrderIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        InOrderIterator &operator--() {
+            if (path.empty()) {
+                descendRight(root);
+                return *this;
+            }
+
+            Node *node = path.back();
+            if (node->left) {
+                descendRight(node->left);
+            } else {
+                Node *child;
+                do {
+                    child = path.back();
+                    path.pop_back();
+                } while (!path.empty() && path.back()->left == child);
+            }
+            return *this;
+        }
+
+        InOrderIterator operator--(int) {
+            InOrderIterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const InOrderIterator &other) const {
+            if (path.empty() || other.path.empty()) return path.empty() && other.path.empty();
+            return path.back() == other.path.back();
+        }
+
+        bool operator!=(const InOrderIterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    // Forward iterator over any K/L/P order, e.g. "KLP" or "PKL"; resumes the walk lazily.
+    class TraversalIterator {
+    private:
+        struct Frame {
+            Node *node;
+            size_t step;
+        };
+
+        std::string format;
+        std::vector<Frame> stack;
+        Node *current;
+
+        void advance() {
+            current = nullptr;
+            while (!stack.empty()) {
+                Frame &frame = stack.back();
+                if (frame.step == format.size()) {
+                    stack.pop_back();
+                    continue;
+                }
+
+                Node *node = frame.node;
+                char c = format[frame.step++];
+                if (c == 'K' || c == 'k') {
+                    current = node;
+                    return;
                 }
-                if (node->right->right) {
-                    Node *tempRight = copySubtree(node->right->right);
-                    newNode->right->right = tempRight;
+                if ((c == 'L' || c == 'l') && node->left) {
+                    stack.push_back({node->left, 0});
+                } else if ((c == 'P' || c == 'p') && node->right) {
+                    stack.push_back({node->right, 0});
                 }
             }
-            return newNode;
         }
 
-        Node *leftResult = extractSubtree(node->left, rootValue);
-        if (leftResult) return leftResult;
+        friend class BinaryTree;
+
+        TraversalIterator(Node *root, const std::string &order) : format(order), current(nullptr) {
+            if (root) {
+                stack.push_back({root, 0});
+                advance();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        TraversalIterator() : current(nullptr) {
+        }
+
+        reference operator*() const {
+            return current->data;
+        }
+
+        pointer operator->() const {
+            return &current->data;
+        }
+
+        TraversalIterator &operator++() {
+            advance();
+            return *this;
+        }
+
+        TraversalIterator operator++(int) {
+            TraversalIterator previous = *this;
+            advance();
+            return previous;
+        }
+
+        bool operator==(const TraversalIterator &other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const TraversalIterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    class TraversalRange {
+    private:
+        Node *root;
+        std::string format;
+
+        friend class BinaryTree;
+
+        TraversalRange(Node *treeRoot, const std::string &order) : root(treeRoot), format(order) {
+        }
+
+    public:
+        TraversalIterator begin() const {
+            return TraversalIterator(root, format);
+        }
+
+        TraversalIterator end() const {
+            return TraversalIterator();
+        }
+    };
+
+private:
+    // Trees smaller than this are transformed on the calling thread.
+    static constexpr size_t PARALLEL_THRESHOLD = 4096;
 
-        return extractSubtree(node->right, rootValue);
+    // Depth down to which subtrees become separate tasks: about four tasks per worker.
+    static int parallelDepth(const ThreadPool &pool) {
+        int depth = 0;
+        while ((size_t(1) << depth) < pool.size() * 4) depth++;
+        return depth;
     }
 
-    Node *copySubtree(Node *node) const {
-        if (!node) return nullptr;
+    // Takes over the nodes of another tree; only valid for stateless allocators.
+    Node *adopt(BinaryTree &&other) {
+        Node *node = other.root;
+        nodeCount += other.nodeCount;
+        other.root = nullptr;
+        other.nodeCount = 0;
+        return node;
+    }
+
+    // Runs the left subtree as a pool task while the calling thread handles the right one.
+    template<typename Build>
+    static BinaryTree forkSubtrees(Node *node, ThreadPool &pool, Build &&build, BinaryTree &right) {
+        auto left = pool.submit([node, &build] {
+            return build(node->left);
+        });
+        try {
+            right = build(node->right);
+        } catch (...) {
+            try {
+                pool.wait(left);
+            } catch (...) {
+            }
+            throw;
+        }
+        return pool.wait(left);
+    }
+
+    static BinaryTree mapParallel(Node *node, const std::function<T(const T &)> &func, ThreadPool &pool, int depth) {
+        BinaryTree result;
+        if (!node) return result;
+        if (depth == 0) {
+            result.root = result.mapTree(node, func);
+            return result;
+        }
 
-        Node *newNode = new Node(node->data);
-        newNode->left = copySubtree(node->left);
-        newNode->right = copySubtree(node->right);
+        BinaryTree right;
+        BinaryTree left = forkSubtrees(node, pool, [&func, &pool, depth](Node *child) {
+            return mapParallel(child, func, pool, depth - 1);
+        }, right);
 
-        return newNode;
+        result.root = result.createNode(func(node->data));
+        copyBookkeeping(result.root, node);
+        result.root->left = result.adopt(std::move(left));
+        result.root->right = result.adopt(std::move(right));
+        return result;
     }
 
-    Node *balanceTree(std::vector<T> &sortedArray, int start, int end) {
-        if (start > end) return nullptr;
+    // Matching items of a subtree in order, collected by parallel tasks.
+    void collectParallel(Node *node, const std::function<bool(const T &)> &predicate, ThreadPool &pool, int depth,
+                         std::vector<T> &matches) const {
+        if (!node) return;
+        if (depth == 0) {
+            walkInOrder(node, [&](Node *current) {
+                if (predicate(current->data)) matches.push_back(current->data);
+            });
+            return;
+        }
 
-        int mid = start + (end - start) / 2;
-        Node *node = new Node(sortedArray[mid]);
+        std::vector<T> leftMatches;
+        auto left = pool.submit([&] {
+            collectParallel(node->left, predicate, pool, depth - 1, leftMatches);
+        });
+        std::vector<T> rightMatches;
+        try {
+            collectParallel(node->right, predicate, pool, depth - 1, rightMatches);
+        } catch (...) {
+            try {
+                pool.wait(left);
+            } catch (...) {
+            }
+            throw;
+        }
+        pool.wait(left);
+
+        matches.insert(matches.end(), std::make_move_iterator(leftMatches.begin()),
+                       std::make_move_iterator(leftMatches.end()));
+        if (predicate(node->data)) matches.push_back(node->data);
+        matches.insert(matches.end(), std::make_move_iterator(rightMatches.begin()),
+                       std::make_move_iterator(rightMatches.end()));
+    }
+
+    // Merges both trees in order and builds a balanced result: O(n + m). The flags select items found
+    // only in this tree, only in the other one, and in both.
+    BinaryTree combine(const BinaryTree &other, bool keepOnlyThis, bool keepOnlyOther, bool keepBoth,
+                       size_t capacity) const {
+        std::vector<T> merged;
+        merged.reserve(capacity);
+
+        InOrderIterator first = begin(), firstEnd = end();
+        InOrderIterator second = other.begin(), secondEnd = other.end();
+        while (first != firstEnd && second != secondEnd) {
+            int compResult = compareItems(*first, *second);
+            if (compResult < 0) {
+                if (keepOnlyThis) merged.push_back(*first);
+                ++first;
+            } else if (compResult > 0) {
+                if (keepOnlyOther) merged.push_back(*second);
+                ++second;
+            } else {
+                if (keepBoth) merged.push_back(*first);
+                ++first;
+                ++second;
+            }
+        }
+        for (; keepOnlyThis && first != firstEnd; ++first) {
+            merged.push_back(*first);
+        }
+        for (; keepOnlyOther && second != secondEnd; ++second) {
+            merged.push_back(*second);
+        }
 
-        node->left = balanceTree(sortedArray, start, mid - 1);
-        node->right = balanceTree(sortedArray, mid + 1, end);
+        BinaryTree result(compare);
+        result.root = result.buildBalanced(merged);
+        return result;
+    }
 
-        return node;
+    // Iterator at the first item not less than (or, if strict, greater than) the given one.
+    InOrderIterator bound(const T &item, bool strict) const {
+        InOrderIterator result(root, true);
+        size_t candidateDepth = 0;
+        Node *node = root;
+        while (node) {
+            result.path.push_back(node);
+            int compResult = compareItems(item, node->data);
+            if (compResult < 0 || (compResult == 0 && !strict)) {
+                candidateDepth = result.path.size();
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        result.path.resize(candidateDepth);
+        return result;
     }
 
 public:
-    BinaryTree() : root(nullptr) {
+    using value_type = T;
+    using iterator = InOrderIterator;
+    using const_iterator = InOrderIterator;
+
+    InOrderIterator begin() const {
+        return InOrderIterator(root, false);
+    }
+
+    InOrderIterator end() const {
+        return InOrderIterator(root, true);
+    }
+
+    // Lazy view of the tree in the given order: for (const T &item : tree.traversal("KPL")) ...
+    TraversalRange traversal(const std::string &format) const {
+        return TraversalRange(root, format);
+    }
+
+    // First item not less than the given one.
+    InOrderIterator lower_bound(const T &item) const {
+        return bound(item, false);
+    }
+
+    // First item greater than the given one.
+    InOrderIterator upper_bound(const T &item) const {
+        return bound(item, true);
+    }
+
+    std::pair<InOrderIterator, InOrderIterator> equal_range(const T &item) const {
+        return {lower_bound(item), upper_bound(item)};
+    }
+
+    // Visits the items in [low, high] in order, skipping subtrees outside the interval: O(height + k).
+    // A visit returning bool stops the scan on false.
+    template<typename Visit>
+    void rangeVisit(const T &low, const T &high, Visit &&visit) const {
+        std::vector<Node *> stack;
+        Node *node = root;
+        while (true) {
+            while (node) {
+                if (compareItems(node->data, low) < 0) {
+                    node = node->right;
+                } else {
+                    stack.push_back(node);
+                    node = node->left;
+                }
+            }
+            if (stack.empty()) return;
+
+            node = stack.back();
+            stack.pop_back();
+            if (compareItems(high, node->data) < 0) return;
+
+            if (!proceed(visit, node->data)) return;
+            node = node->right;
+        }
+    }
+
+    BinaryTree() : root(nullptr), nodeCount(0) {
     }
 
-    BinaryTree(const BinaryTree &other) {
+    explicit BinaryTree(const Compare &comparator) : compare(comparator), root(nullptr), nodeCount(0) {
+    }
+
+    BinaryTree(const BinaryTree &other) : compare(other.compare), root(nullptr), nodeCount(0) {
         root = copyTree(other.root);
     }
 
     BinaryTree &operator=(const BinaryTree &other) {
         if (this != &other) {
-            deleteTree(root);
+            clear();
+            compare = other.compare;
             root = copyTree(other.root);
         }
         return *this;
     }
 
-    BinaryTree(BinaryTree &&other) noexcept : root(other.root) {
+    BinaryTree(BinaryTree &&other) noexcept
+        : allocator(std::move(other.allocator)), compare(std::move(other.compare)), root(other.root),
+          nodeCount(other.nodeCount) {
         other.root = nullptr;
+        other.nodeCount = 0;
     }
 
     BinaryTree &operator=(BinaryTree &&other) noexcept {
         if (this != &other) {
-            deleteTree(root);
+            clear();
+            allocator = std::move(other.allocator);
+            compare = std::move(other.compare);
             root = other.root;
+            nodeCount = other.nodeCount;
             other.root = nullptr;
+            other.nodeCount = 0;
         }
         return *this;
     }
 
     ~BinaryTree() {
-        deleteTree(root);
+        clear();
     }
 
-    void insert(const T &item) {
-        root = insertNode(root, item);
+    // The inserts return the stored item, which is the existing one for a duplicate, and whether
+    // the item was inserted, so callers need no second lookup.
+    std::pair<const T *, bool> insert(const T &item) {
+        auto [node, inserted] = insertWith(item, [&] {
+            return createNode(item);
+        });
+        return {&node->data, inserted};
+    }
+
+    std::pair<const T *, bool> insert(T &&item) {
+        auto [node, inserted] = insertWith(item, [&] {
+            return createNode(std::move(item));
+        });
+        return {&node->data, inserted};
+    }
+
+    // Builds the item in place from the arguments; it is destroyed again if an equal item is present.
+    template<typename... Args>
+    std::pair<const T *, bool> emplace(Args &&... args) {
+        Node *node = createNode(std::forward<Args>(args)...);
+        auto [stored, inserted] = insertWith(node->data, [&] {
+            return node;
+        });
+        if (!inserted) destroyNode(node);
+        return {&stored->data, inserted};
     }
 
     bool contains(const T &item) const {
         return findNode(root, item) != nullptr;
     }
 
+    // Stored item equal to the given one, or nullptr.
+    const T *find(const T &item) const {
+        Node *node = findNode(root, item);
+        return node ? &node->data : nullptr;
+    }
+
     void remove(const T &item) {
-        root = deleteNode(root, item);
+        removeItem(item);
+    }
+
+    // Lookups by the key alone for trees ordered with CompareBy, so no item has to be built to
+    // search for one, e.g. tree.find(PersonID{...}) in a tree of Students ordered by their ID.
+    template<typename Key> requires isKeyOf<Key>
+    bool contains(const Key &key) const {
+        return findNode(root, key) != nullptr;
+    }
+
+    template<typename Key> requires isKeyOf<Key>
+    const T *find(const Key &key) const {
+        Node *node = findNode(root, key);
+        return node ? &node->data : nullptr;
+    }
+
+    template<typename Key> requires isKeyOf<Key>
+    void remove(const Key &key) {
+        removeItem(key);
+    }
+
+    // Stored item with the key, built in place from the arguments only if the key is missing; the
+    // arguments must build an item with that key.
+    template<typename Key, typename... Args> requires isKeyOf<Key>
+    std::pair<const T *, bool> tryEmplace(const Key &key, Args &&... args) {
+        auto [node, inserted] = insertWith(key, [&] {
+            return createNode(std::forward<Args>(args)...);
+        });
+        return {&node->data, inserted};
     }
 
-    BinaryTree<T> map(const std::function<T(const T &)> &func) const {
-        BinaryTree<T> result;
-        result.root = mapTree(root, func);
+    BinaryTree map(const std::function<T(const T &)> &func) const {
+        BinaryTree result(compare);
+        result.root = result.mapTree(root, func);
         return result;
     }
 
-    BinaryTree<T> where(const std::function<bool(const T &)> &predicate) const {
-        BinaryTree<T> result;
-        result.root = whereTree(root, predicate);
+    // Matching items only, collected in order in one pass and built into a balanced tree: O(n).
+    BinaryTree where(const std::function<bool(const T &)> &predicate) const {
+        std::vector<T> matches;
+        walkInOrder(root, [&](Node *current) {
+            if (predicate(current->data)) matches.push_back(current->data);
+        });
+
+        BinaryTree result(compare);
+        result.root = result.buildBalanced(matches);
         return result;
     }
 
-    bool containsSubtree(const BinaryTree<T> &subtree) const {
+    // In-place where: unlinks and frees the items that do not match and relinks the kept nodes into
+    // a balanced tree, without allocating nodes or copying items. Returns the number removed.
+    template<typename Predicate>
+    size_t whereInPlace(Predicate &&predicate) {
+        return removeIf([&predicate](const T &item) {
+            return !predicate(item);
+        });
+    }
+
+    // Parallel map: subtrees near the root are copied as separate tasks on the pool, so func must be
+    // safe to call concurrently. Falls back to map(func) for small trees and stateful allocators.
+    BinaryTree map(const std::function<T(const T &)> &func, ThreadPool &pool) const {
+        if constexpr (Allocator::stateless) {
+            if (nodeCount >= PARALLEL_THRESHOLD && pool.size() > 1) {
+                BinaryTree result = mapParallel(root, func, pool, parallelDepth(pool));
+                result.compare = compare;
+                return result;
+            }
+        }
+        return map(func);
+    }
+
+    // Parallel where: subtrees near the root are scanned as separate tasks, so predicate must be safe
+    // to call concurrently. Falls back to where(predicate) for small trees.
+    BinaryTree where(const std::function<bool(const T &)> &predicate, ThreadPool &pool) const {
+        if (nodeCount < PARALLEL_THRESHOLD || pool.size() < 2) return where(predicate);
+
+        std::vector<T> matches;
+        collectParallel(root, predicate, pool, parallelDepth(pool), matches);
+        BinaryTree result(compare);
+        result.root = result.buildBalanced(matches);
+        return result;
+    }
+
+    // Same items in the same shape. Trees holding the same items can differ in shape when they were
+    // built in another order, even with a balancing policy; compare traverseInOrder() for set equality.
+    bool sameShape(const BinaryTree &other) const {
+        return nodeCount == other.nodeCount && areIdentical(root, other.root);
+    }
+
+    // Structural fingerprint: trees of the same shape have equal fingerprints, so a hash table keyed
+    // on it can deduplicate them and call sameShape() only on collisions. Like sameShape(), it tells
+    // apart the same items in different shapes. O(n).
+    size_t fingerprint() const {
+        static_assert(isHashable, "fingerprint() requires std::hash<T>");
+        return fingerprintTree(root, [](Node *, size_t, size_t) {
+            return true;
+        });
+    }
+
+    // Whether the other tree occurs here with the same shape and items. A hit at the place a search
+    // for its root leads to costs O(log n + m). Otherwise every call fingerprints this whole tree
+    // again, O(n + m), since nothing is cached between calls.
+    bool containsSubtree(const BinaryTree &subtree) const {
         if (!subtree.root) return true;
         if (!root) return false;
 
         return isSubtree(root, subtree.root);
     }
 
-    BinaryTree<T> extractSubtree(const T &rootValue) const {
-        BinaryTree<T> result;
-        result.root = extractSubtree(root, rootValue);
+    BinaryTree extractSubtree(const T &rootValue) const {
+        BinaryTree result(compare);
+        result.root = result.extractSubtree(root, rootValue);
+        if constexpr (isRedBlack) {
+            if (result.root) result.root->tag = BLACK;
+        }
         return result;
     }
 
-    BinaryTree<T> merge(const BinaryTree<T> &other) const {
-        BinaryTree<T> result(*this);
+    // Set union.
+    BinaryTree merge(const BinaryTree &other) const {
+        return combine(other, true, true, true, nodeCount + other.nodeCount);
+    }
 
-        std::vector<T> values;
-        std::vector<T> otherValues = other.traverseInOrder();
+    BinaryTree intersection(const BinaryTree &other) const {
+        return combine(other, false, false, true, std::min(nodeCount, other.nodeCount));
+    }
+
+    // Items of this tree that are not in the other one.
+    BinaryTree difference(const BinaryTree &other) const {
+        return combine(other, true, false, false, nodeCount);
+    }
+
+    BinaryTree symmetricDifference(const BinaryTree &other) const {
+        return combine(other, true, true, false, nodeCount + other.nodeCount);
+    }
+
+    // Moves the items less than key into the first tree and the rest into the second one, leaving
+    // this tree empty. Nodes are relinked, not copied. The relinking is O(log n) on self-balancing
+    // trees, but the new item counts need the size of the smaller part, so the whole split is
+    // O(log n + min(k, n - k)) for k items below key, and O(log n) only with OrderStatistics.
+    std::pair<BinaryTree, BinaryTree> split(const T &key) {
+        static_assert(Allocator::stateless, "split() moves nodes between trees and needs a stateless allocator");
 
-        for (const T &value: otherValues) {
-            result.insert(value);
+        Part less, greater;
+        Node *match;
+        splitTree(rootPart(), key, less, greater, match);
+        if (match) {
+            greater = joinTrees({nullptr, 0}, match, greater);
         }
+        blacken(less);
+        blacken(greater);
+
+        std::pair<BinaryTree, BinaryTree> result{BinaryTree(compare), BinaryTree(compare)};
+        result.first.root = less.node;
+        result.first.nodeCount = countFirst(less.node, greater.node, nodeCount);
+        result.second.root = greater.node;
+        result.second.nodeCount = nodeCount - result.first.nodeCount;
+        root = nullptr;
+        nodeCount = 0;
+        return result;
+    }
 
+    // Concatenates two trees, every item of left being smaller than every item of right, by
+    // relinking their nodes; both are left empty. O(log n) on self-balancing trees.
+    static BinaryTree join(BinaryTree &&left, BinaryTree &&right) {
+        static_assert(Allocator::stateless, "join() moves nodes between trees and needs a stateless allocator");
+
+        if (left.root && right.root) {
+            Node *last = left.root;
+            while (last->right) last = last->right;
+            Node *first = right.root;
+            while (first->left) first = first->left;
+            if (left.compareItems(last->data, first->data) >= 0) {
+                throw std::invalid_argument("join() needs every item of the left tree below those of the right tree");
+            }
+        }
+
+        BinaryTree result(left.compare);
+        result.root = concatenate(left.rootPart(), right.rootPart()).node;
+        result.nodeCount = left.nodeCount + right.nodeCount;
+        left.root = right.root = nullptr;
+        left.nodeCount = right.nodeCount = 0;
         return result;
     }
 
+    // Relinks the existing nodes; no item is copied and nothing but the node list is allocated.
     void balance() {
-        std::vector<T> sortedValues;
-        traverseInOrder(root, sortedValues);
+        std::vector<Node *> sortedNodes;
+        sortedNodes.reserve(nodeCount);
+        walkInOrder(root, [&](Node *current) {
+            sortedNodes.push_back(current);
+        });
+        root = relinkBalanced(sortedNodes);
+    }
+
+    // Removes every item in [low, high] and returns how many there were. The range is cut out with
+    // two splits, freed in one walk, and the two remaining parts are joined again: O(log n + k) on
+    // self-balancing trees.
+    size_t removeRange(const T &low, const T &high) {
+        if (compareItems(high, low) < 0) return 0;
+
+        size_t before = nodeCount;
+        Part less, rest, range, greater;
+        Node *lowMatch, *highMatch;
+        splitTree(rootPart(), low, less, rest, lowMatch);
+        splitTree(rest, high, range, greater, highMatch);
+
+        deleteTree(range.node);
+        if (lowMatch) destroyNode(lowMatch);
+        if (highMatch) destroyNode(highMatch);
+
+        Part joined = concatenate(less, greater);
+        blacken(joined);
+        root = joined.node;
+        return before - nodeCount;
+    }
+
+    // Removes every item matching the predicate in one in-order pass and rebuilds the remaining
+    // nodes into a balanced tree without allocating nodes or copying items: O(n). The only
+    // allocation is one list of node pointers, filled with the kept nodes in order from the front
+    // and the removed ones from the back. Nothing is freed until every item has been tested, so a
+    // throwing predicate leaves the tree unchanged. Returns the number removed.
+    template<typename Predicate>
+    size_t removeIf(Predicate &&predicate) {
+        std::vector<Node *> nodes(nodeCount);
+        size_t keptCount = 0, removedStart = nodes.size();
+        walkInOrder(root, [&](Node *current) {
+            if (predicate(std::as_const(current->data))) {
+                nodes[--removedStart] = current;
+            } else {
+                nodes[keptCount++] = current;
+            }
+        });
+        size_t removedCount = nodes.size() - removedStart;
+        if (removedCount == 0) return 0;
 
-        deleteTree(root);
-        root = balanceTree(sortedValues, 0, sortedValues.size() - 1);
+        for (size_t i = removedStart; i < nodes.size(); i++) {
+            destroyNode(nodes[i]);
+        }
+        nodes.resize(keptCount);
+        root = relinkBalanced(nodes);
+        return removedCount;
+    }
+
+    // Replaces the contents with the given items as a perfectly balanced tree. Already sorted input
+    // is detected and not sorted again; duplicates are dropped. O(n) after sorting.
+    template<typename Range>
+    void bulkLoad(const Range &items) {
+        bulkLoad(std::vector<T>(std::begin(items), std::end(items)));
+    }
+
+    void bulkLoad(std::vector<T> &&items) {
+        auto less = [this](const T &a, const T &b) {
+            return compareItems(a, b) < 0;
+        };
+        if (!std::is_sorted(items.begin(), items.end(), less)) {
+            std::sort(items.begin(), items.end(), less);
+        }
+        items.erase(std::unique(items.begin(), items.end(), [this](const T &a, const T &b) {
+            return compareItems(a, b) == 0;
+        }), items.end());
+
+        clear();
+        root = buildBalanced(items);
     }
 
     std::vector<T> traverseInOrder() const {
         std::vector<T> result;
-        traverseInOrder(root, result);
+        result.reserve(nodeCount);
+        walkInOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traversePreOrder() const {
         std::vector<T> result;
-        traversePreOrder(root, result);
+        result.reserve(nodeCount);
+        walkPreOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traversePostOrder() const {
         std::vector<T> result;
-        traversePostOrder(root, result);
+        result.reserve(nodeCount);
+        walkPostOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traverseKLP() const {
         std::vector<T> result;
-        traverseKLP(root, result);
+        result.reserve(nodeCount);
+        walkPreOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traverseKPL() const {
         std::vector<T> result;
-        traverseKPL(root, result);
+        result.reserve(nodeCount);
+        walkPreOrder<true>(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traverseLPK() const {
         std::vector<T> result;
-        traverseLPK(root, result);
+        result.reserve(nodeCount);
+        walkPostOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traverseLKP() const {
         std::vector<T> result;
-        traverseLKP(root, result);
+        result.reserve(nodeCount);
+        walkInOrder(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traversePLK() const {
         std::vector<T> result;
-        traversePLK(root, result);
+        result.reserve(nodeCount);
+        walkPostOrder<true>(root, appendTo(result));
         return result;
     }
 
     std::vector<T> traversePKL() const {
         std::vector<T> result;
-        traversePKL(root, result);
+        result.reserve(nodeCount);
+        walkInOrder<true>(root, appendTo(result));
         return result;
     }
 
@@ -480,29 +1984,76 @@ public:
     }
 
     void traverseCustom(Node *node, std::vector<T> &result, const std::string &format) const {
-        if (!node) return;
-
-        for (char c: format) {
-            if (c == 'K' || c == 'k') {
-                result.push_back(node->data);
-            } else if (c == 'L' || c == 'l') {
-                traverseCustom(node->left, result, format);
-            } else if (c == 'P' || c == 'p') {
-                traverseCustom(node->right, result, format);
-            }
-        }
+        traverse(node, result, format);
     }
 
     std::string saveToString(const std::string &format = "KLP") const {
         std::string result;
-        serializeTree(root, result, format);
+        serializeTree(root, format, [&](const std::string &token) {
+            result += token;
+        });
         return result;
     }
 
     void loadFromString(const std::string &str, const std::string &format = "KLP") {
-        deleteTree(root);
         std::istringstream iss(str);
-        root = deserializeTree(iss, format);
+        load(iss, format);
+    }
+
+    // Same encoding as saveToString, written token by token; check the stream state afterwards.
+    void save(std::ostream &out, const std::string &format = "KLP") const {
+        serializeTree(root, format, [&](const std::string &token) {
+            out << token;
+        });
+    }
+
+    // Reads what save() or saveToString() produced, one token at a time. If parsing throws, the
+    // tree is left empty.
+    void load(std::istream &in, const std::string &format = "KLP") {
+        clear();
+        try {
+            deserializeTree(in, format, root);
+        } catch (...) {
+            clear();
+            throw;
+        }
+        restoreInvariants();
+    }
+
+    // Compact, lossless snapshot; element types other than integers, floating point and
+    // std::string need a BinaryCodec specialization.
+    std::string saveToBinary() const {
+        std::string result;
+        StringWriter out(result);
+        writeBinary(out);
+        return result;
+    }
+
+    // Throws std::runtime_error on malformed data and leaves the tree empty.
+    void loadFromBinary(const std::string &data) {
+        StringReader in(data);
+        readBinary(in);
+    }
+
+    void saveToBinary(std::ostream &out) const {
+        StreamWriter writer(out);
+        writeBinary(writer);
+    }
+
+    void loadFromBinary(std::istream &in) {
+        StreamReader reader(in);
+        readBinary(reader);
+    }
+
+    // Immutable, array-backed copy for read-only workloads; later changes to this tree do not affect it.
+    FrozenTree<T> freeze() const {
+        static_assert(std::is_same_v<Compare, ThreeWayCompare>, "FrozenTree searches with the natural order of T");
+        return FrozenTree<T>(begin(), nodeCount);
+    }
+
+    // Writes the items as a FrozenTree snapshot that FrozenTree<T>::open() maps without parsing.
+    void saveSnapshot(const std::string &path) const {
+        freeze().save(path);
     }
 
     bool isEmpty() const {
@@ -510,13 +2061,68 @@ public:
     }
 
     int size() const {
-        return traverseInOrder().size();
+        return nodeCount;
+    }
+
+    // Item at the given 0-based position in sorted order.
+    const T &kth(size_t index) const {
+        static_assert(tracksSubtreeSize, "kth() requires an OrderStatistics<...> balancing policy");
+        if (index >= nodeCount) {
+            throw std::out_of_range("Index out of range");
+        }
+
+        Node *node = root;
+        while (true) {
+            size_t leftSize = subtreeSizeOf(node->left);
+            if (index < leftSize) {
+                node = node->left;
+            } else if (index == leftSize) {
+                return node->data;
+            } else {
+                index -= leftSize + 1;
+                node = node->right;
+            }
+        }
+    }
+
+    // Number of items less than the given one.
+    size_t rank(const T &item) const {
+        static_assert(tracksSubtreeSize, "rank() requires an OrderStatistics<...> balancing policy");
+        size_t result = 0;
+        Node *node = root;
+        while (node) {
+            int compResult = compareItems(item, node->data);
+            if (compResult <= 0) {
+                if (compResult == 0) return result + subtreeSizeOf(node->left);
+                node = node->left;
+            } else {
+                result += subtreeSizeOf(node->left) + 1;
+                node = node->right;
+            }
+        }
+        return result;
+    }
+
+    template<typename Comparator, typename A, typename B>
+    static int threeWay(const Comparator &comparator, const A &a, const B &b) {
+        using Result = decltype(comparator(a, b));
+        if constexpr (std::is_same_v<Result, bool>) {
+            if (comparator(a, b)) return -1;
+            if (comparator(b, a)) return 1;
+            return 0;
+        } else {
+            Result order = comparator(a, b);
+            return order < 0 ? -1 : (order > 0 ? 1 : 0);
+        }
     }
 
     int compareItems(const T &a, const T &b) const {
-        if (a < b) return -1;
-        if (b < a) return 1;
-        return 0;
+        return threeWay(compare, a, b);
+    }
+
+    template<typename Key> requires isKeyOf<Key>
+    int compareItems(const Key &key, const T &item) const {
+        return threeWay(typename Compare::KeyCompare{}, key, Compare::keyOf(item));
     }
 };
 
@@ -536,45 +2142,74 @@ private:
 
     Node *root;
     size_t nextId;
+    size_t nodeCount;
 
     void deleteTree(Node *node) {
-        if (node) {
-            deleteTree(node->left);
-            deleteTree(node->right);
-            delete node;
+        std::vector<Node *> stack;
+        if (node) stack.push_back(node);
+        while (!stack.empty()) {
+            Node *current = stack.back();
+            stack.pop_back();
+            if (current->left) stack.push_back(current->left);
+            if (current->right) stack.push_back(current->right);
+            delete current;
         }
     }
 
     Node *copyTree(Node *node) {
         if (!node) return nullptr;
 
-        Node *newNode = new Node(node->data, node->id);
-        newNode->left = copyTree(node->left);
-        newNode->right = copyTree(node->right);
+        Node *copy = new Node(node->data, node->id);
+        std::vector<std::pair<Node *, Node *> > stack;
+        stack.push_back({node, copy});
+        while (!stack.empty()) {
+            auto [source, target] = stack.back();
+            stack.pop_back();
+            if (source->left) {
+                target->left = new Node(source->left->data, source->left->id);
+                stack.push_back({source->left, target->left});
+            }
+            if (source->right) {
+                target->right = new Node(source->right->data, source->right->id);
+                stack.push_back({source->right, target->right});
+            }
+        }
 
-        return newNode;
+        return copy;
     }
 
     Node *insertNode(Node *node, const std::function<R(Args...)> &item) {
-        if (!node) return new Node(item, nextId++);
+        Node *newNode = new Node(item, nextId++);
+        nodeCount++;
+        if (!node) return newNode;
 
-        node->right = insertNode(node->right, item);
+        Node *last = node;
+        while (last->right) {
+            last = last->right;
+        }
+        last->right = newNode;
         return node;
     }
 
     void traverseInOrder(Node *node, std::vector<std::function<R(Args...)> > &result) const {
-        if (!node) return;
-
-        traverseInOrder(node->left, result);
-        result.push_back(node->data);
-        traverseInOrder(node->right, result);
+        std::vector<Node *> stack;
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            result.push_back(node->data);
+            node = node->right;
+        }
     }
 
 public:
-    BinaryTree() : root(nullptr), nextId(0) {
+    BinaryTree() : root(nullptr), nextId(0), nodeCount(0) {
     }
 
-    BinaryTree(const BinaryTree &other) : nextId(other.nextId) {
+    BinaryTree(const BinaryTree &other) : nextId(other.nextId), nodeCount(other.nodeCount) {
         root = copyTree(other.root);
     }
 
@@ -583,12 +2218,14 @@ public:
             deleteTree(root);
             root = copyTree(other.root);
             nextId = other.nextId;
+            nodeCount = other.nodeCount;
         }
         return *this;
     }
 
-    BinaryTree(BinaryTree &&other) noexcept : root(other.root), nextId(other.nextId) {
+    BinaryTree(BinaryTree &&other) noexcept : root(other.root), nextId(other.nextId), nodeCount(other.nodeCount) {
         other.root = nullptr;
+        other.nodeCount = 0;
     }
 
     BinaryTree &operator=(BinaryTree &&other) noexcept {
@@ -596,7 +2233,9 @@ public:
             deleteTree(root);
             root = other.root;
             nextId = other.nextId;
+            nodeCount = other.nodeCount;
             other.root = nullptr;
+            other.nodeCount = 0;
         }
         return *this;
     }
@@ -620,9 +2259,7 @@ public:
     }
 
     int size() const {
-        std::vector<std::function<R(Args...)> > values;
-        traverseInOrder(root, values);
-        return values.size();
+        return nodeCount;
     }
 };
 
@@ -639,6 +2276,7 @@ private:
     };
 
     Node *root;
+    size_t nodeCount;
 
     int compareComplex(const std::complex<ValueType> &a, const std::complex<ValueType> &b) const {
         if (a.real() < b.real()) return -1;
@@ -649,62 +2287,82 @@ private:
     }
 
     void deleteTree(Node *node) {
-        if (node) {
-            deleteTree(node->left);
-            deleteTree(node->right);
-            delete node;
+        std::vector<Node *> stack;
+        if (node) stack.push_back(node);
+        while (!stack.empty()) {
+            Node *current = stack.back();
+            stack.pop_back();
+            if (current->left) stack.push_back(current->left);
+            if (current->right) stack.push_back(current->right);
+            delete current;
         }
     }
 
     Node *copyTree(Node *node) {
         if (!node) return nullptr;
 
-        Node *newNode = new Node(node->data);
-        newNode->left = copyTree(node->left);
-        newNode->right = copyTree(node->right);
+        Node *copy = new Node(node->data);
+        std::vector<std::pair<Node *, Node *> > stack;
+        stack.push_back({node, copy});
+        while (!stack.empty()) {
+            auto [source, target] = stack.back();
+            stack.pop_back();
+            if (source->left) {
+                target->left = new Node(source->left->data);
+                stack.push_back({source->left, target->left});
+            }
+            if (source->right) {
+                target->right = new Node(source->right->data);
+                stack.push_back({source->right, target->right});
+            }
+        }
 
-        return newNode;
+        return copy;
     }
 
     Node *insertNode(Node *node, const std::complex<ValueType> &item) {
-        if (!node) return new Node(item);
-
-        int compResult = compareComplex(item, node->data);
-        if (compResult < 0) {
-            node->left = insertNode(node->left, item);
-        } else if (compResult > 0) {
-            node->right = insertNode(node->right, item);
+        Node **link = &node;
+        while (*link) {
+            int compResult = compareComplex(item, (*link)->data);
+            if (compResult == 0) return node;
+            link = compResult < 0 ? &(*link)->left : &(*link)->right;
         }
+        *link = new Node(item);
+        nodeCount++;
 
         return node;
     }
 
     Node *findNode(Node *node, const std::complex<ValueType> &item) const {
-        if (!node) return nullptr;
-
-        int compResult = compareComplex(item, node->data);
-        if (compResult == 0) {
-            return node;
-        } else if (compResult < 0) {
-            return findNode(node->left, item);
-        } else {
-            return findNode(node->right, item);
+        while (node) {
+            int compResult = compareComplex(item, node->data);
+            if (compResult == 0) {
+                return node;
+            }
+            node = compResult < 0 ? node->left : node->right;
         }
+        return nullptr;
     }
 
     void traverseInOrder(Node *node, std::vector<std::complex<ValueType> > &result) const {
-        if (!node) return;
-
-        traverseInOrder(node->left, result);
-        result.push_back(node->data);
-        traverseInOrder(node->right, result);
+        std::vector<Node *> stack;
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            result.push_back(node->data);
+            node = node->right;
+        }
     }
 
 public:
-    BinaryTree() : root(nullptr) {
+    BinaryTree() : root(nullptr), nodeCount(0) {
     }
 
-    BinaryTree(const BinaryTree &other) {
+    BinaryTree(const BinaryTree &other) : nodeCount(other.nodeCount) {
         root = copyTree(other.root);
     }
 
@@ -712,6 +2370,7 @@ public:
         if (this != &other) {
             deleteTree(root);
             root = copyTree(other.root);
+            nodeCount = other.nodeCount;
         }
         return *this;
     }
@@ -739,9 +2398,7 @@ public:
     }
 
     int size() const {
-        std::vector<std::complex<ValueType> > values;
-        traverseInOrder(root, values);
-        return values.size();
+        return nodeCount;
     }
 };
 
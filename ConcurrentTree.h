@@ -0,0 +1,154 @@
+#ifndef CONCURRENT_TREE_H
+#define CONCURRENT_TREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PersistentTree.h"
+
+// Sorted set shared between threads in the style of RCU. The current version is a plain atomic
+// pointer, so a reader takes no lock and touches no shared reference count: it bumps a counter in
+// its own cache line, loads the pointer and searches that version. Writers take turns on a mutex;
+// each one derives the next PersistentTree version, which copies only the O(log n) nodes on the
+// path it changes, publishes it with one atomic store and frees the old version after a grace
+// period, once every reader that could still see it has left.
+//
+// Each query checks in on its own, so a thread that runs many queries back to back should take
+// one snapshot() and reuse it instead.
+template<typename T>
+class ConcurrentTree {
+private:
+    static constexpr size_t READER_SLOTS = 64;
+
+    // Readers of both epoch parities currently inside a query. Threads are spread over the slots
+    // and each slot sits on its own cache line, so readers on different threads rarely share one.
+    struct alignas(64) ReaderSlot {
+        std::atomic<long> active[2] = {0, 0};
+    };
+
+    std::atomic<const PersistentTree<T> *> current;
+    std::atomic<unsigned> epoch{0};
+    mutable ReaderSlot slots[READER_SLOTS];
+    std::mutex writeMutex;
+
+    static size_t slotIndex() {
+        static thread_local const size_t index =
+                std::hash<std::thread::id>()(std::this_thread::get_id()) % READER_SLOTS;
+        return index;
+    }
+
+    // Marks the calling thread as a reader of the current version for its lifetime.
+    class ReadGuard {
+    private:
+        std::atomic<long> &counter;
+
+    public:
+        const PersistentTree<T> *version;
+
+        explicit ReadGuard(const ConcurrentTree &tree)
+            : counter(tree.slots[slotIndex()].active[tree.epoch.load() & 1]) {
+            counter.fetch_add(1);
+            version = tree.current.load();
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ~ReadGuard() {
+            counter.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    void waitForReaders(unsigned parity) const {
+        for (const ReaderSlot &slot: slots) {
+            while (slot.active[parity].load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Swaps in the next version and frees the old one once no reader can hold it. A reader that
+    // checked in before the swap is counted under the parity it read, and that may be the older
+    // one if it read the epoch just before the previous flip, so both parities are drained: the
+    // idle one first, then the active one after flipping the epoch away from it. A reader that
+    // checks in later loads the new pointer. Called with writeMutex held.
+    void replace(const PersistentTree<T> *next) {
+        const PersistentTree<T> *old = current.exchange(next);
+        unsigned active = epoch.load();
+        waitForReaders((active + 1) & 1);
+        epoch.store(active + 1);
+        waitForReaders(active & 1);
+        delete old;
+    }
+
+    template<typename Change>
+    void publish(Change &&change) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const PersistentTree<T> *version = current.load();
+        PersistentTree<T> next = change(*version);
+        if (next.size() != version->size()) {
+            replace(new PersistentTree<T>(std::move(next)));
+        }
+    }
+
+public:
+    ConcurrentTree() : current(new PersistentTree<T>()) {
+    }
+
+    ConcurrentTree(const ConcurrentTree &) = delete;
+
+    ConcurrentTree &operator=(const ConcurrentTree &) = delete;
+
+    ~ConcurrentTree() {
+        delete current.load();
+    }
+
+    // Consistent, immutable view of the current version; stays unchanged while writers go on.
+    PersistentTree<T> snapshot() const {
+        ReadGuard guard(*this);
+        return *guard.version;
+    }
+
+    void insert(const T &item) {
+        publish([&](const PersistentTree<T> &version) {
+            return version.insert(item);
+        });
+    }
+
+    void remove(const T &item) {
+        publish([&](const PersistentTree<T> &version) {
+            return version.remove(item);
+        });
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        replace(new PersistentTree<T>());
+    }
+
+    bool contains(const T &item) const {
+        ReadGuard guard(*this);
+        return guard.version->contains(item);
+    }
+
+    std::vector<T> traverseInOrder() const {
+        ReadGuard guard(*this);
+        return guard.version->traverseInOrder();
+    }
+
+    bool isEmpty() const {
+        ReadGuard guard(*this);
+        return guard.version->isEmpty();
+    }
+
+    int size() const {
+        ReadGuard guard(*this);
+        return guard.version->size();
+    }
+};
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef DATA_TYPES_H
 #define DATA_TYPES_H
 
+#include <compare>
 #include <iostream>
 #include <string>
 #include <complex>
 #include <functional>
 #include <ctime>
 #include <memory>
+#include "BinaryCodec.h"
 
 typedef std::complex<double> Complex;
 
@@ -41,6 +43,14 @@ struct PersonID {
         return other < *this;
     }
 
+    // Lets trees order IDs with a single comparison per node.
+    std::strong_ordering operator<=>(const PersonID &other) const {
+        if (std::strong_ordering order = series <=> other.series; order != 0) {
+            return order;
+        }
+        return number <=> other.number;
+    }
+
     friend std::ostream &operator<<(std::ostream &os, const PersonID &id) {
         os << id.series << "-" << id.number;
         return os;
@@ -90,6 +100,10 @@ public:
         return other < *this;
     }
 
+    std::strong_ordering operator<=>(const Person &other) const {
+        return id <=> other.id;
+    }
+
     friend std::ostream &operator<<(std::ostream &os, const Person &person) {
         os << person.GetFullName() << " (ID: " << person.id << ")";
         return os;
@@ -158,4 +172,76 @@ public:
     }
 };
 
+template<>
+struct BinaryCodec<PersonID> {
+    template<typename Writer>
+    static void write(Writer &out, const PersonID &id) {
+        BinaryCodec<int>::write(out, id.series);
+        BinaryCodec<int>::write(out, id.number);
+    }
+
+    template<typename Reader>
+    static PersonID read(Reader &in) {
+        int series = BinaryCodec<int>::read(in);
+        int number = BinaryCodec<int>::read(in);
+        return PersonID(series, number);
+    }
+};
+
+template<>
+struct BinaryCodec<Student> {
+    template<typename Writer>
+    static void write(Writer &out, const Student &student) {
+        BinaryCodec<PersonID>::write(out, student.GetID());
+        BinaryCodec<std::string>::write(out, student.GetFirstName());
+        BinaryCodec<std::string>::write(out, student.GetMiddleName());
+        BinaryCodec<std::string>::write(out, student.GetLastName());
+        BinaryCodec<std::time_t>::write(out, student.GetBirthDate());
+        BinaryCodec<std::string>::write(out, student.GetGroup());
+        BinaryCodec<int>::write(out, student.GetStudentID());
+        BinaryCodec<double>::write(out, student.GetAverageGrade());
+    }
+
+    template<typename Reader>
+    static Student read(Reader &in) {
+        PersonID id = BinaryCodec<PersonID>::read(in);
+        std::string first = BinaryCodec<std::string>::read(in);
+        std::string middle = BinaryCodec<std::string>::read(in);
+        std::string last = BinaryCodec<std::string>::read(in);
+        std::time_t birth = BinaryCodec<std::time_t>::read(in);
+        std::string group = BinaryCodec<std::string>::read(in);
+        int studentID = BinaryCodec<int>::read(in);
+        double averageGrade = BinaryCodec<double>::read(in);
+        return Student(id, first, middle, last, birth, group, studentID, averageGrade);
+    }
+};
+
+template<>
+struct BinaryCodec<Teacher> {
+    template<typename Writer>
+    static void write(Writer &out, const Teacher &teacher) {
+        BinaryCodec<PersonID>::write(out, teacher.GetID());
+        BinaryCodec<std::string>::write(out, teacher.GetFirstName());
+        BinaryCodec<std::string>::write(out, teacher.GetMiddleName());
+        BinaryCodec<std::string>::write(out, teacher.GetLastName());
+        BinaryCodec<std::time_t>::write(out, teacher.GetBirthDate());
+        BinaryCodec<std::string>::write(out, teacher.GetDepartment());
+        BinaryCodec<std::string>::write(out, teacher.GetPosition());
+        BinaryCodec<int>::write(out, teacher.GetExperience());
+    }
+
+    template<typename Reader>
+    static Teacher read(Reader &in) {
+        PersonID id = BinaryCodec<PersonID>::read(in);
+        std::string first = BinaryCodec<std::string>::read(in);
+        std::string middle = BinaryCodec<std::string>::read(in);
+        std::string last = BinaryCodec<std::string>::read(in);
+        std::time_t birth = BinaryCodec<std::time_t>::read(in);
+        std::string department = BinaryCodec<std::string>::read(in);
+        std::string position = BinaryCodec<std::string>::read(in);
+        int experience = BinaryCodec<int>::read(in);
+        return Teacher(id, first, middle, last, birth, department, position, experience);
+    }
+};
+
 #endif
@@ -0,0 +1,475 @@
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Visitor.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FROZEN_TREE_MMAP 1
+#endif
+
+// AVX2 batch search is compiled in for x86 GCC/Clang and picked at run time when the CPU has it.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FROZEN_TREE_AVX2 1
+#endif
+
+// Read-only mapping of a whole file. Without mmap the file is read into memory instead.
+class MappedFile {
+private:
+    const char *bytes;
+    size_t length;
+    std::vector<char> buffer;
+
+public:
+    MappedFile() : bytes(nullptr), length(0) {
+    }
+
+    explicit MappedFile(const std::string &path) : bytes(nullptr), length(0) {
+#ifdef FROZEN_TREE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void *memory = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path);
+            }
+            bytes = static_cast<const char *>(memory);
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+        : bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0)),
+          buffer(std::move(other.buffer)) {
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            unmap();
+            bytes = std::exchange(other.bytes, nullptr);
+            length = std::exchange(other.length, 0);
+            buffer = std::move(other.buffer);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    const char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    void unmap() {
+#ifdef FROZEN_TREE_MMAP
+        if (bytes) {
+            ::munmap(const_cast<char *>(bytes), length);
+        }
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+};
+
+// Immutable sorted set stored in Eytzinger (breadth-first) order: the children of slot k are
+// slots 2k and 2k + 1, so a search touches one array and needs no pointers. The items either live
+// in an owned vector or directly in a mapped snapshot file, which opens without any parsing.
+// Slot 0 is padding and slot 0 starts a cache line, so the 2^d descendants d levels below any
+// slot share a line once 2^d items fill it; searches prefetch that line while comparing.
+template<typename T>
+class FrozenTree {
+    static_assert(std::is_trivially_copyable_v<T>, "FrozenTree stores items as raw bytes");
+
+private:
+    // Snapshot file: this header, padded to a cache line, followed by the slots from 0 on.
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+        uint32_t itemSize;
+    };
+
+    static constexpr char FILE_MAGIC[4] = {'B', 'T', 'E', 'Z'};
+    static constexpr uint32_t FILE_VERSION = 2;
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t DATA_OFFSET = CACHE_LINE;
+    // Descendants this many slots per level below are prefetched: four levels down for 4-byte items.
+    static constexpr size_t PREFETCH_STRIDE = sizeof(T) < CACHE_LINE ? std::bit_floor(CACHE_LINE / sizeof(T)) : 1;
+
+    std::vector<T> storage;
+    MappedFile mapping;
+    const T *items;
+    size_t count;
+
+    const T &slot(size_t k) const {
+        return items[k];
+    }
+
+    // Prefetches the descendants of slot k PREFETCH_STRIDE slots per level below. Near the last levels
+    // that is past the array, so the slot is clamped: even an address that is never read must not be
+    // formed beyond the end.
+    void prefetchBelow(size_t k) const {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(items + std::min(k * PREFETCH_STRIDE, count));
+#else
+        (void) k;
+#endif
+    }
+
+    size_t leftmost(size_t k) const {
+        while (2 * k <= count) k *= 2;
+        return k;
+    }
+
+    size_t rightmost(size_t k) const {
+        while (2 * k + 1 <= count) k = 2 * k + 1;
+        return k;
+    }
+
+    // Slot of the first item not less (strict: greater) than the given one, or 0. The descent has
+    // no data-dependent branch: k records the path, and the trailing ones it ends with are the right
+    // turns taken after the last left turn, which is where the answer lies.
+    template<bool strict>
+    size_t bound(const T &item) const {
+        size_t k = 1;
+        while (k <= count) {
+            prefetchBelow(k);
+            if constexpr (strict) {
+                k = 2 * k + !(item < slot(k));
+            } else {
+                k = 2 * k + (slot(k) < item);
+            }
+        }
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    // Whether the slot a descent ended past (see bound) holds the item.
+    bool found(size_t k, const T &item) const {
+        k >>= std::countr_one(k) + 1;
+        return k && !(item < slot(k));
+    }
+
+    static constexpr size_t BATCH_LANES = 16;
+
+    // Levels every descent passes through before the last, possibly partial, one.
+    size_t fullLevels() const {
+        return std::bit_width(count + 1) - 1;
+    }
+
+    // Runs up to BATCH_LANES searches side by side, one level at a time, so their cache misses overlap
+    // instead of queueing behind each other.
+    void containsLanes(const T *keys, bool *out, size_t lanes) const {
+        size_t k[BATCH_LANES];
+        std::fill(k, k + lanes, 1);
+        for (size_t level = fullLevels(); level > 0; level--) {
+            for (size_t i = 0; i < lanes; i++) {
+                prefetchBelow(k[i]);
+                k[i] = 2 * k[i] + (slot(k[i]) < keys[i]);
+            }
+        }
+        for (size_t i = 0; i < lanes; i++) {
+            if (k[i] <= count) k[i] = 2 * k[i] + (slot(k[i]) < keys[i]);
+            out[i] = found(k[i], keys[i]);
+        }
+    }
+
+#ifdef FROZEN_TREE_AVX2
+    // Sixteen 32-bit keys in two vectors: each level gathers the current slots, compares them with the
+    // keys and moves all indices down at once. Only used for signed 32-bit T.
+    __attribute__((target("avx2")))
+    void containsSixteen(const T *keys, bool *out) const {
+        const int *base = reinterpret_cast<const int *>(items);
+        __m256i key[2], k[2];
+        for (int v = 0; v < 2; v++) {
+            key[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + 8 * v));
+            k[v] = _mm256_set1_epi32(1);
+        }
+        for (size_t level = fullLevels(); level > 0; level--) {
+            for (int v = 0; v < 2; v++) {
+                __m256i right = _mm256_cmpgt_epi32(key[v], _mm256_i32gather_epi32(base, k[v], 4));
+                k[v] = _mm256_sub_epi32(_mm256_add_epi32(k[v], k[v]), right);
+            }
+        }
+
+        __m256i limit = _mm256_set1_epi32(static_cast<int>(count + 1));
+        alignas(32) uint32_t slots[16];
+        for (int v = 0; v < 2; v++) {
+            __m256i inside = _mm256_cmpgt_epi32(limit, k[v]);
+            __m256i value = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, k[v], inside, 4);
+            __m256i right = _mm256_cmpgt_epi32(key[v], value);
+            __m256i deeper = _mm256_sub_epi32(_mm256_add_epi32(k[v], k[v]), right);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(slots + 8 * v), _mm256_blendv_epi8(k[v], deeper, inside));
+        }
+        for (int i = 0; i < 16; i++) {
+            out[i] = found(slots[i], keys[i]);
+        }
+    }
+#endif
+
+    template<typename Iterator>
+    void fill(T *slots, Iterator &next, size_t k) {
+        if (k > count) return;
+        fill(slots, next, 2 * k);
+        slots[k] = *next;
+        ++next;
+        fill(slots, next, 2 * k + 1);
+    }
+
+public:
+    class Iterator {
+    private:
+        const FrozenTree *tree;
+        size_t k;
+
+        friend class FrozenTree;
+
+        Iterator(const FrozenTree *owner, size_t slotIndex) : tree(owner), k(slotIndex) {
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        Iterator() : tree(nullptr), k(0) {
+        }
+
+        reference operator*() const {
+            return tree->slot(k);
+        }
+
+        pointer operator->() const {
+            return &tree->slot(k);
+        }
+
+        Iterator &operator++() {
+            if (2 * k + 1 <= tree->count) {
+                k = tree->leftmost(2 * k + 1);
+            } else {
+                while (k & 1) k >>= 1;
+                k >>= 1;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        Iterator &operator--() {
+            if (k == 0) {
+                k = tree->count ? tree->rightmost(1) : 0;
+            } else if (2 * k <= tree->count) {
+                k = tree->rightmost(2 * k);
+            } else {
+                while (k > 1 && !(k & 1)) k >>= 1;
+                k >>= 1;
+            }
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            Iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return k == other.k;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return k != other.k;
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+    using value_type = T;
+
+    FrozenTree() : items(nullptr), count(0) {
+    }
+
+    // Builds the layout from items in strictly increasing order.
+    template<typename InputIterator>
+    FrozenTree(InputIterator first, size_t itemCount)
+        : storage(itemCount + 1 + CACHE_LINE / sizeof(T)), items(nullptr), count(itemCount) {
+        T *slots = storage.data();
+        T *last = slots + CACHE_LINE / sizeof(T);
+        while (slots < last && reinterpret_cast<uintptr_t>(slots) % CACHE_LINE != 0) slots++;
+        fill(slots, first, 1);
+        items = slots;
+    }
+
+    FrozenTree(FrozenTree &&other) noexcept
+        : storage(std::move(other.storage)), mapping(std::move(other.mapping)),
+          items(std::exchange(other.items, nullptr)), count(std::exchange(other.count, 0)) {
+    }
+
+    FrozenTree &operator=(FrozenTree &&other) noexcept {
+        if (this != &other) {
+            storage = std::move(other.storage);
+            mapping = std::move(other.mapping);
+            items = std::exchange(other.items, nullptr);
+            count = std::exchange(other.count, 0);
+        }
+        return *this;
+    }
+
+    // Maps a snapshot written by save(); the file must stay unchanged while the tree is alive.
+    static FrozenTree open(const std::string &path) {
+        FrozenTree tree;
+        tree.mapping = MappedFile(path);
+
+        FileHeader header;
+        if (tree.mapping.size() < DATA_OFFSET) {
+            throw std::runtime_error("Not a frozen tree snapshot: " + path);
+        }
+        std::memcpy(&header, tree.mapping.data(), sizeof(header));
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+            throw std::runtime_error("Not a frozen tree snapshot: " + path);
+        }
+        if (header.version != FILE_VERSION || header.itemSize != sizeof(T)) {
+            throw std::runtime_error("Incompatible frozen tree snapshot: " + path);
+        }
+        if (header.count >= (tree.mapping.size() - DATA_OFFSET) / sizeof(T)) {
+            throw std::runtime_error("Truncated frozen tree snapshot: " + path);
+        }
+
+        tree.items = reinterpret_cast<const T *>(tree.mapping.data() + DATA_OFFSET);
+        tree.count = header.count;
+        return tree;
+    }
+
+    void save(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+
+        char header[DATA_OFFSET] = {};
+        FileHeader fields = {{FILE_MAGIC[0], FILE_MAGIC[1], FILE_MAGIC[2], FILE_MAGIC[3]}, FILE_VERSION, count, sizeof(T)};
+        std::memcpy(header, &fields, sizeof(fields));
+        file.write(header, sizeof(header));
+        if (items) {
+            file.write(reinterpret_cast<const char *>(items), static_cast<std::streamsize>((count + 1) * sizeof(T)));
+        } else {
+            // A default-constructed or moved-from tree has no slots; its file still gets slot 0.
+            char padding[sizeof(T)] = {};
+            file.write(padding, sizeof(padding));
+        }
+        if (!file) {
+            throw std::runtime_error("Cannot write " + path);
+        }
+    }
+
+    Iterator begin() const {
+        return Iterator(this, count ? leftmost(1) : 0);
+    }
+
+    Iterator end() const {
+        return Iterator(this, 0);
+    }
+
+    bool contains(const T &item) const {
+        size_t k = bound<false>(item);
+        return k && !(item < slot(k));
+    }
+
+    // out[i] = contains(keys[i]), with the searches interleaved; out must be as long as keys.
+    void containsBatch(std::span<const T> keys, std::span<bool> out) const {
+        if (keys.size() != out.size()) {
+            throw std::invalid_argument("containsBatch: keys and out must have the same size");
+        }
+
+        size_t i = 0;
+#ifdef FROZEN_TREE_AVX2
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4) {
+            if (count < (size_t(1) << 30) && __builtin_cpu_supports("avx2")) {
+                for (; i + 16 <= keys.size(); i += 16) {
+                    containsSixteen(keys.data() + i, out.data() + i);
+                }
+            }
+        }
+#endif
+        for (; i < keys.size(); i += BATCH_LANES) {
+            containsLanes(keys.data() + i, out.data() + i, std::min(BATCH_LANES, keys.size() - i));
+        }
+    }
+
+    Iterator lower_bound(const T &item) const {
+        return Iterator(this, bound<false>(item));
+    }
+
+    Iterator upper_bound(const T &item) const {
+        return Iterator(this, bound<true>(item));
+    }
+
+    // Visits the items in [low, high] in order; visit may return false to stop.
+    template<typename Visit>
+    void rangeVisit(const T &low, const T &high, Visit &&visit) const {
+        for (Iterator it = lower_bound(low); it != end() && !(high < *it); ++it) {
+            if (!proceed(visit, *it)) return;
+        }
+    }
+
+    bool isEmpty() const {
+        return count == 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef NODE_ALLOCATOR_H
+#define NODE_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Node allocators for BinaryTree<T, Balance, Allocator>. Every tree owns its own allocator instance.
+
+// Allocates every node separately with operator new.
+class HeapNodeAllocator {
+public:
+    static constexpr bool releasesInBulk = false;
+    // Nodes may be allocated from any thread and handed over between trees.
+    static constexpr bool stateless = true;
+
+    void *allocate(size_t bytes) {
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void *memory, size_t bytes) {
+        ::operator delete(memory, bytes);
+    }
+
+    void release() {
+    }
+};
+
+// Carves fixed-size slots out of large blocks and recycles freed slots through a free list.
+// release() returns every block at once, so a tree of trivially destructible items is torn down
+// without visiting its nodes.
+class ArenaNodeAllocator {
+private:
+    struct FreeSlot {
+        FreeSlot *next;
+    };
+
+    static constexpr size_t FIRST_BLOCK_SLOTS = 64;
+    static constexpr size_t MAX_BLOCK_SLOTS = 65536;
+
+    std::vector<void *> blocks;
+    FreeSlot *freeList;
+    char *cursor;
+    char *blockEnd;
+    size_t slotSize;
+    size_t nextBlockSlots;
+
+    void addBlock() {
+        size_t bytes = slotSize * nextBlockSlots;
+        char *block = static_cast<char *>(::operator new(bytes));
+        blocks.push_back(block);
+        cursor = block;
+        blockEnd = block + bytes;
+        if (nextBlockSlots < MAX_BLOCK_SLOTS) {
+            nextBlockSlots *= 2;
+        }
+    }
+
+public:
+    static constexpr bool releasesInBulk = true;
+    static constexpr bool stateless = false;
+
+    ArenaNodeAllocator()
+        : freeList(nullptr), cursor(nullptr), blockEnd(nullptr), slotSize(0), nextBlockSlots(FIRST_BLOCK_SLOTS) {
+    }
+
+    ArenaNodeAllocator(const ArenaNodeAllocator &) = delete;
+
+    ArenaNodeAllocator &operator=(const ArenaNodeAllocator &) = delete;
+
+    ArenaNodeAllocator(ArenaNodeAllocator &&other) noexcept
+        : blocks(std::move(other.blocks)), freeList(other.freeList), cursor(other.cursor),
+          blockEnd(other.blockEnd), slotSize(other.slotSize), nextBlockSlots(other.nextBlockSlots) {
+        other.blocks.clear();
+        other.freeList = nullptr;
+        other.cursor = nullptr;
+        other.blockEnd = nullptr;
+        other.nextBlockSlots = FIRST_BLOCK_SLOTS;
+    }
+
+    ArenaNodeAllocator &operator=(ArenaNodeAllocator &&other) noexcept {
+        if (this != &other) {
+            release();
+            blocks = std::move(other.blocks);
+            freeList = other.freeList;
+            cursor = other.cursor;
+            blockEnd = other.blockEnd;
+            slotSize = other.slotSize;
+            nextBlockSlots = other.nextBlockSlots;
+            other.blocks.clear();
+            other.freeList = nullptr;
+            other.cursor = nullptr;
+            other.blockEnd = nullptr;
+            other.nextBlockSlots = FIRST_BLOCK_SLOTS;
+        }
+        return *this;
+    }
+
+    ~ArenaNodeAllocator() {
+        release();
+    }
+
+    // All requests must have the same size; the first one fixes the slot size.
+    void *allocate(size_t bytes) {
+        if (freeList) {
+            FreeSlot *slot = freeList;
+            freeList = slot->next;
+            return slot;
+        }
+
+        if (slotSize == 0) {
+            size_t alignment = alignof(std::max_align_t);
+            size_t size = bytes < sizeof(FreeSlot) ? sizeof(FreeSlot) : bytes;
+            slotSize = (size + alignment - 1) / alignment * alignment;
+        }
+
+        if (cursor == blockEnd) {
+            addBlock();
+        }
+
+        void *memory = cursor;
+        cursor += slotSize;
+        return memory;
+    }
+
+    void deallocate(void *memory, size_t) {
+        FreeSlot *slot = static_cast<FreeSlot *>(memory);
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    void release() {
+        for (void *block: blocks) {
+            ::operator delete(block);
+        }
+        blocks.clear();
+        freeList = nullptr;
+        cursor = nullptr;
+        blockEnd = nullptr;
+        nextBlockSlots = FIRST_BLOCK_SLOTS;
+    }
+};
+
+#endif
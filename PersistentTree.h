@@ -0,0 +1,192 @@
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Visitor.h"
+
+// Immutable sorted set with structural sharing. insert() and remove() leave this version untouched
+// and return a new one that copies only the O(log n) nodes on the changed path (the tree is
+// AVL-balanced) and shares every other subtree through reference-counted nodes. Copying a version
+// is O(1), so keeping old versions around as snapshots costs only the nodes they do not share.
+template<typename T>
+class PersistentTree {
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        T data;
+        NodePtr left;
+        NodePtr right;
+        int height;
+    };
+
+    NodePtr root;
+    int count;
+
+    PersistentTree(NodePtr treeRoot, int itemCount) : root(std::move(treeRoot)), count(itemCount) {
+    }
+
+    static int height(const NodePtr &node) {
+        return node ? node->height : 0;
+    }
+
+    static NodePtr makeNode(const T &data, NodePtr left, NodePtr right) {
+        int nodeHeight = 1 + std::max(height(left), height(right));
+        return std::make_shared<const Node>(Node{data, std::move(left), std::move(right), nodeHeight});
+    }
+
+    // New node over the given children, rotated if their heights differ by two.
+    static NodePtr balance(const T &data, NodePtr left, NodePtr right) {
+        if (height(left) > height(right) + 1) {
+            if (height(left->left) >= height(left->right)) {
+                return makeNode(left->data, left->left, makeNode(data, left->right, std::move(right)));
+            }
+            const NodePtr &pivot = left->right;
+            return makeNode(pivot->data, makeNode(left->data, left->left, pivot->left),
+                            makeNode(data, pivot->right, std::move(right)));
+        }
+        if (height(right) > height(left) + 1) {
+            if (height(right->right) >= height(right->left)) {
+                return makeNode(right->data, makeNode(data, std::move(left), right->left), right->right);
+            }
+            const NodePtr &pivot = right->left;
+            return makeNode(pivot->data, makeNode(data, std::move(left), pivot->left),
+                            makeNode(right->data, pivot->right, right->right));
+        }
+        return makeNode(data, std::move(left), std::move(right));
+    }
+
+    // The unchanged node itself is returned when the item is already there, so nothing is copied.
+    static NodePtr insertNode(const NodePtr &node, const T &item, bool &inserted) {
+        if (!node) {
+            inserted = true;
+            return makeNode(item, nullptr, nullptr);
+        }
+        if (item < node->data) {
+            NodePtr left = insertNode(node->left, item, inserted);
+            return inserted ? balance(node->data, std::move(left), node->right) : node;
+        }
+        if (node->data < item) {
+            NodePtr right = insertNode(node->right, item, inserted);
+            return inserted ? balance(node->data, node->left, std::move(right)) : node;
+        }
+        return node;
+    }
+
+    static NodePtr removeMin(const NodePtr &node, T &minimum) {
+        if (!node->left) {
+            minimum = node->data;
+            return node->right;
+        }
+        return balance(node->data, removeMin(node->left, minimum), node->right);
+    }
+
+    static NodePtr removeNode(const NodePtr &node, const T &item, bool &removed) {
+        if (!node) return node;
+        if (item < node->data) {
+            NodePtr left = removeNode(node->left, item, removed);
+            return removed ? balance(node->data, std::move(left), node->right) : node;
+        }
+        if (node->data < item) {
+            NodePtr right = removeNode(node->right, item, removed);
+            return removed ? balance(node->data, node->left, std::move(right)) : node;
+        }
+
+        removed = true;
+        if (!node->left) return node->right;
+        if (!node->right) return node->left;
+        T successor = node->data;
+        NodePtr right = removeMin(node->right, successor);
+        return balance(successor, node->left, std::move(right));
+    }
+
+public:
+    PersistentTree() : root(nullptr), count(0) {
+    }
+
+    // New version with the item added; returns this version again if the item is already there.
+    PersistentTree insert(const T &item) const {
+        bool inserted = false;
+        NodePtr newRoot = insertNode(root, item, inserted);
+        return inserted ? PersistentTree(std::move(newRoot), count + 1) : *this;
+    }
+
+    // New version without the item; returns this version again if the item is not there.
+    PersistentTree remove(const T &item) const {
+        bool removed = false;
+        NodePtr newRoot = removeNode(root, item, removed);
+        return removed ? PersistentTree(std::move(newRoot), count - 1) : *this;
+    }
+
+    bool contains(const T &item) const {
+        const Node *node = root.get();
+        while (node) {
+            if (item < node->data) {
+                node = node->left.get();
+            } else if (node->data < item) {
+                node = node->right.get();
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Visits the items in [low, high] of this version in order, until a visit returns false.
+    template<typename Visit>
+    void rangeVisit(const T &low, const T &high, Visit &&visit) const {
+        std::vector<const Node *> stack;
+        const Node *node = root.get();
+        while (true) {
+            while (node) {
+                if (node->data < low) {
+                    node = node->right.get();
+                } else {
+                    stack.push_back(node);
+                    node = node->left.get();
+                }
+            }
+            if (stack.empty()) return;
+
+            node = stack.back();
+            stack.pop_back();
+            if (high < node->data) return;
+
+            if (!proceed(visit, node->data)) return;
+            node = node->right.get();
+        }
+    }
+
+    std::vector<T> traverseInOrder() const {
+        std::vector<T> result;
+        result.reserve(count);
+        std::vector<const Node *> stack;
+        const Node *node = root.get();
+        while (node || !stack.empty()) {
+            while (node) {
+                stack.push_back(node);
+                node = node->left.get();
+            }
+            node = stack.back();
+            stack.pop_back();
+            result.push_back(node->data);
+            node = node->right.get();
+        }
+        return result;
+    }
+
+    bool isEmpty() const {
+        return root == nullptr;
+    }
+
+    int size() const {
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task queue. A worker takes its newest task first
+// and, when its queue is empty, steals the oldest task of another worker. A thread waiting on a
+// result keeps running queued tasks, so nested fork-join work cannot deadlock the pool.
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    // How long a waiting thread with nothing to run sleeps before it looks for new tasks again.
+    static constexpr std::chrono::microseconds IDLE_WAIT{200};
+
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::vector<std::thread> workers;
+    std::atomic<long> pending;
+    std::atomic<size_t> nextQueue;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    static inline thread_local ThreadPool *currentPool = nullptr;
+    static inline thread_local size_t currentIndex = 0;
+
+    size_t ownQueue() const {
+        return currentPool == this ? currentIndex : 0;
+    }
+
+    bool tryRunOne(size_t preferred) {
+        std::function<void()> task;
+        for (size_t i = 0; i < queues.size() && !task; i++) {
+            WorkQueue &queue = *queues[(preferred + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+
+        if (!task) return false;
+        pending--;
+        task();
+        return true;
+    }
+
+    void workerLoop(size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        while (true) {
+            if (tryRunOne(index)) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this] {
+                return stopping || pending > 0;
+            });
+            if (stopping && pending <= 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : pending(0), nextQueue(0), stopping(false) {
+        threadCount = std::max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this, i] {
+                workerLoop(i);
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker: workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    template<typename Task>
+    std::future<std::invoke_result_t<std::decay_t<Task> > > submit(Task &&task) {
+        using Result = std::invoke_result_t<std::decay_t<Task> >;
+
+        auto packaged = std::make_shared<std::packaged_task<Result()> >(std::forward<Task>(task));
+        std::future<Result> result = packaged->get_future();
+
+        size_t index = currentPool == this ? currentIndex : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back([packaged] {
+                (*packaged)();
+            });
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pending++;
+        }
+        wakeUp.notify_one();
+
+        return result;
+    }
+
+    // Blocks until the result is ready, running queued tasks in the meantime. With nothing to run it
+    // sleeps on the future, waking up now and then to look for new tasks instead of spinning.
+    template<typename Result>
+    Result wait(std::future<Result> &future) {
+        size_t index = ownQueue();
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!tryRunOne(index)) {
+                future.wait_for(IDLE_WAIT);
+            }
+        }
+        return future.get();
+    }
+
+    // Process-wide pool sized to the hardware concurrency.
+    static ThreadPool &shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
+
+#endif
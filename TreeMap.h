@@ -0,0 +1,210 @@
+#ifndef TREE_MAP_H
+#define TREE_MAP_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "BinaryTree.h"
+
+// Key with its value, stored in a single tree node. The tree orders entries by key only, so the
+// value is mutable and can change in place without unbalancing anything.
+template<typename K, typename V>
+struct MapEntry {
+    K key;
+    mutable V value;
+};
+
+// Ordered map on top of BinaryTree with any balancing policy and allocator. Lookups search by the
+// key alone, so nothing is copied or constructed to find an entry.
+template<typename K, typename V, typename Balance = NoBalancing, typename Allocator = HeapNodeAllocator>
+class TreeMap {
+private:
+    using Entry = MapEntry<K, V>;
+    using Tree = BinaryTree<Entry, Balance, Allocator, CompareBy<&Entry::key> >;
+
+    Tree tree;
+
+public:
+    using iterator = typename Tree::iterator;
+    using const_iterator = typename Tree::const_iterator;
+    using value_type = Entry;
+
+    iterator begin() const {
+        return tree.begin();
+    }
+
+    iterator end() const {
+        return tree.end();
+    }
+
+    // Adds the key or replaces its value; one descent either way.
+    void insert(const K &key, const V &value) {
+        auto [entry, inserted] = tree.tryEmplace(key, key, value);
+        if (!inserted) {
+            entry->value = value;
+        }
+    }
+
+    // Value of the key, inserted default-constructed if missing.
+    V &operator[](const K &key) {
+        return tree.tryEmplace(key, key, V()).first->value;
+    }
+
+    V *find(const K &key) {
+        const Entry *entry = tree.find(key);
+        return entry ? &entry->value : nullptr;
+    }
+
+    const V *find(const K &key) const {
+        const Entry *entry = tree.find(key);
+        return entry ? &entry->value : nullptr;
+    }
+
+    bool contains(const K &key) const {
+        return tree.contains(key);
+    }
+
+    void remove(const K &key) {
+        tree.remove(key);
+    }
+
+    void clear() {
+        tree = Tree();
+    }
+
+    std::vector<std::pair<K, V> > traverseInOrder() const {
+        std::vector<std::pair<K, V> > result;
+        result.reserve(tree.size());
+        for (const Entry &entry: tree) {
+            result.emplace_back(entry.key, entry.value);
+        }
+        return result;
+    }
+
+    bool isEmpty() const {
+        return tree.isEmpty();
+    }
+
+    int size() const {
+        return tree.size();
+    }
+};
+
+// One node of a TreeMultiset: the first item inserted, how many equal items the node stands for and,
+// unless equal items are identical, the later ones in insertion order.
+template<typename T>
+struct MultisetEntry {
+    struct NoEqualItems {
+    };
+
+    static constexpr bool keepsEqualItems = !std::is_scalar_v<T>;
+    using EqualItems = std::conditional_t<keepsEqualItems, std::vector<T>, NoEqualItems>;
+
+    T item;
+    mutable size_t count;
+    [[no_unique_address]] mutable EqualItems later;
+};
+
+// Sorted multiset with one node per distinct item, so repeated items never cost a node. Equal scalars
+// are identical and only raise the count. Other items may be equal under the order yet differ, such
+// as Students sharing a PersonID, so every one of them is kept in its node's chain.
+template<typename T, typename Balance = NoBalancing, typename Allocator = HeapNodeAllocator>
+class TreeMultiset {
+private:
+    using Entry = MultisetEntry<T>;
+    using Tree = BinaryTree<Entry, Balance, Allocator, CompareBy<&Entry::item> >;
+
+    static constexpr bool keepsEqualItems = Entry::keepsEqualItems;
+
+    Tree tree;
+    size_t itemCount = 0;
+
+public:
+    void insert(const T &item, size_t occurrences = 1) {
+        if (occurrences == 0) return;
+        auto [entry, inserted] = tree.tryEmplace(item, item, size_t(0), typename Entry::EqualItems());
+        if constexpr (keepsEqualItems) {
+            for (size_t i = inserted; i < occurrences; i++) {
+                entry->later.push_back(item);
+            }
+        }
+        entry->count += occurrences;
+        itemCount += occurrences;
+    }
+
+    // Removes one occurrence of the item, the last one inserted, if there is any.
+    void remove(const T &item) {
+        const Entry *entry = tree.find(item);
+        if (!entry) return;
+
+        itemCount--;
+        if (entry->count == 1) {
+            tree.remove(item);
+            return;
+        }
+        entry->count--;
+        if constexpr (keepsEqualItems) {
+            entry->later.pop_back();
+        }
+    }
+
+    // Removes every occurrence of the item.
+    void removeAll(const T &item) {
+        if (const Entry *entry = tree.find(item)) {
+            itemCount -= entry->count;
+            tree.remove(item);
+        }
+    }
+
+    size_t count(const T &item) const {
+        const Entry *entry = tree.find(item);
+        return entry ? entry->count : 0;
+    }
+
+    bool contains(const T &item) const {
+        return tree.contains(item);
+    }
+
+    void clear() {
+        tree = Tree();
+        itemCount = 0;
+    }
+
+    // Every item as often as it occurs, in order; equal items in the order they were inserted.
+    std::vector<T> traverseInOrder() const {
+        std::vector<T> result;
+        result.reserve(itemCount);
+        for (const Entry &entry: tree) {
+            if constexpr (keepsEqualItems) {
+                result.push_back(entry.item);
+                result.insert(result.end(), entry.later.begin(), entry.later.end());
+            } else {
+                result.insert(result.end(), entry.count, entry.item);
+            }
+        }
+        return result;
+    }
+
+    // Visits each distinct item once with its number of occurrences.
+    template<typename Visit>
+    void forEachDistinct(Visit &&visit) const {
+        for (const Entry &entry: tree) {
+            visit(entry.item, entry.count);
+        }
+    }
+
+    bool isEmpty() const {
+        return itemCount == 0;
+    }
+
+    size_t size() const {
+        return itemCount;
+    }
+
+    int distinctSize() const {
+        return tree.size();
+    }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef VISITOR_H
+#define VISITOR_H
+
+#include <type_traits>
+#include <utility>
+
+// Calls visit with the arguments and tells whether the walk goes on. Visitors of the tree walks and
+// range scans may return nothing, or bool to stop the walk by returning false.
+template<typename Visit, typename... Args>
+bool proceed(Visit &visit, Args &&... args) {
+    if constexpr (std::is_same_v<std::invoke_result_t<Visit &, Args...>, bool>) {
+        return visit(std::forward<Args>(args)...);
+    } else {
+        visit(std::forward<Args>(args)...);
+        return true;
+    }
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <chrono>
 #include <random>
 #include <fstream>
@@ -6,7 +7,14 @@
 #include <functional>
 #include <vector>
 #include <complex>
+#include <cstdio>
+#include <mutex>
+#include <thread>
 #include "BinaryTree.h"
+#include "BTree.h"
+#include "ConcurrentTree.h"
+#include "PersistentTree.h"
+#include "TreeMap.h"
 #include "DataTypes.h"
 
 template<typename Func>
@@ -91,6 +99,24 @@ void demonstrateDataTypes() {
     for (const Student &student: studentTree.traverseInOrder()) {
         std::cout << student << std::endl;
     }
+    BinaryTree<Student, NoBalancing, HeapNodeAllocator, CompareBy<&Student::GetAverageGrade> > gradeTree;
+    gradeTree.insert(student1);
+    gradeTree.insert(student2);
+    gradeTree.insert(student3);
+    std::cout << "Students ordered by average grade:" << std::endl;
+    for (const Student &student: gradeTree.traverseInOrder()) {
+        std::cout << student.GetFullName() << ": " << student.GetAverageGrade() << std::endl;
+    }
+    Student student1Again(PersonID(1234, 567890), "Ivan", "Ivanovich", "Ivanov",
+                          std::time(nullptr) - 86400 * 365 * 20, "Department 3", 12348, 4.2);
+    TreeMultiset<Student> studentRecords;
+    studentRecords.insert(student1);
+    studentRecords.insert(student2);
+    studentRecords.insert(student1Again);
+    std::cout << "Student records, two sharing a PersonID (" << studentRecords.distinctSize() << " nodes):" << std::endl;
+    for (const Student &student: studentRecords.traverseInOrder()) {
+        std::cout << student << std::endl;
+    }
     std::cout << "\n7. Professors tree\n";
     BinaryTree<Teacher> teacherTree;
     Teacher teacher1(PersonID(5678, 123456), "Alex", "Alekseevich", "Alekseev",
@@ -166,8 +192,51 @@ public:
                     tree.insert(value);
                 }
             });
+            double time_arena = measureExecutionTime([&]() {
+                BinaryTree<int, NoBalancing, ArenaNodeAllocator> tree;
+                for (int value: values) {
+                    tree.insert(value);
+                }
+            });
+            double time_btree = measureExecutionTime([&]() {
+                BTree<int> tree;
+                for (int value: values) {
+                    tree.insert(value);
+                }
+            });
+            double time_multiset = measureExecutionTime([&]() {
+                TreeMultiset<int> tree;
+                for (int value: values) {
+                    tree.insert(value);
+                }
+            });
+            // Keys longer than the small string buffer, so a copy means a heap allocation.
+            double time_string_copy = measureExecutionTime([&]() {
+                BinaryTree<std::string, RedBlackBalancing> tree;
+                for (int value: values) {
+                    std::string key = "student-record-" + std::to_string(value);
+                    tree.insert(key);
+                }
+            });
+            double time_string_move = measureExecutionTime([&]() {
+                BinaryTree<std::string, RedBlackBalancing> tree;
+                for (int value: values) {
+                    std::string key = "student-record-" + std::to_string(value);
+                    tree.insert(std::move(key));
+                }
+            });
             std::cout << "Insert " << size << " elements: " << time << " ms" << std::endl;
+            std::cout << "Insert " << size << " elements (arena allocator): " << time_arena << " ms" << std::endl;
+            std::cout << "Insert " << size << " elements (B-tree): " << time_btree << " ms" << std::endl;
+            std::cout << "Insert " << size << " elements (multiset, duplicates kept): " << time_multiset << " ms" << std::endl;
+            std::cout << "Insert " << size << " strings (copied): " << time_string_copy << " ms" << std::endl;
+            std::cout << "Insert " << size << " strings (moved): " << time_string_move << " ms" << std::endl;
             outputFile << "insert," << size << "," << time << std::endl;
+            outputFile << "insert_arena," << size << "," << time_arena << std::endl;
+            outputFile << "insert_btree," << size << "," << time_btree << std::endl;
+            outputFile << "insert_multiset," << size << "," << time_multiset << std::endl;
+            outputFile << "insert_string_copy," << size << "," << time_string_copy << std::endl;
+            outputFile << "insert_string_move," << size << "," << time_string_move << std::endl;
         }
     }
 
@@ -186,8 +255,33 @@ public:
                     tree.contains(value);
                 }
             });
+            BTree<int> btree;
+            for (int value: values) {
+                btree.insert(value);
+            }
+            double time_btree = measureExecutionTime([&]() {
+                for (int value: searchValues) {
+                    btree.contains(value);
+                }
+            });
+            FrozenTree<int> frozen = tree.freeze();
+            double time_frozen = measureExecutionTime([&]() {
+                for (int value: searchValues) {
+                    frozen.contains(value);
+                }
+            });
+            std::unique_ptr<bool[]> found(new bool[searchValues.size()]);
+            double time_batch = measureExecutionTime([&]() {
+                frozen.containsBatch(searchValues, std::span<bool>(found.get(), searchValues.size()));
+            });
             std::cout << "Search in tree with " << size << " elements: " << time << " ms" << std::endl;
+            std::cout << "Search in B-tree with " << size << " elements: " << time_btree << " ms" << std::endl;
+            std::cout << "Search in frozen tree with " << size << " elements: " << time_frozen << " ms" << std::endl;
+            std::cout << "Batched search in frozen tree with " << size << " elements: " << time_batch << " ms" << std::endl;
             outputFile << "search," << size << "," << time << std::endl;
+            outputFile << "search_btree," << size << "," << time_btree << std::endl;
+            outputFile << "search_frozen," << size << "," << time_frozen << std::endl;
+            outputFile << "search_frozen_batch," << size << "," << time_batch << std::endl;
         }
     }
 
@@ -212,14 +306,23 @@ public:
             double time_lkp = measureExecutionTime([&]() {
                 tree.traverseLKP();
             });
+            double time_iterator = measureExecutionTime([&]() {
+                long long sum = 0;
+                for (int value: tree) {
+                    sum += value;
+                }
+                return sum;
+            });
             std::cout << "KLP traversal with " << size << " elements: " << time_klp << " ms" << std::endl;
             std::cout << "KPL traversal with " << size << " elements: " << time_kpl << " ms" << std::endl;
             std::cout << "LPK traversal with " << size << " elements: " << time_lpk << " ms" << std::endl;
             std::cout << "LKP traversal with " << size << " elements: " << time_lkp << " ms" << std::endl;
+            std::cout << "In-order iteration with " << size << " elements: " << time_iterator << " ms" << std::endl;
             outputFile << "traversal_klp," << size << "," << time_klp << std::endl;
             outputFile << "traversal_kpl," << size << "," << time_kpl << std::endl;
             outputFile << "traversal_lpk," << size << "," << time_lpk << std::endl;
             outputFile << "traversal_lkp," << size << "," << time_lkp << std::endl;
+            outputFile << "traversal_iterator," << size << "," << time_iterator << std::endl;
         }
     }
 
@@ -235,8 +338,13 @@ public:
             double time = measureExecutionTime([&]() {
                 tree.map([](const int &x) { return x * 2; });
             });
+            double time_parallel = measureExecutionTime([&]() {
+                tree.map([](const int &x) { return x * 2; }, ThreadPool::shared());
+            });
             std::cout << "Map with " << size << " elements: " << time << " ms" << std::endl;
+            std::cout << "Parallel map with " << size << " elements: " << time_parallel << " ms" << std::endl;
             outputFile << "map," << size << "," << time << std::endl;
+            outputFile << "map_parallel," << size << "," << time_parallel << std::endl;
         }
     }
 
@@ -252,8 +360,19 @@ public:
             double time = measureExecutionTime([&]() {
                 tree.where([](const int &x) { return x % 2 == 0; });
             });
+            double time_parallel = measureExecutionTime([&]() {
+                tree.where([](const int &x) { return x % 2 == 0; }, ThreadPool::shared());
+            });
+            BinaryTree<int> filtered = tree;
+            double time_in_place = measureExecutionTime([&]() {
+                filtered.whereInPlace([](const int &x) { return x % 2 == 0; });
+            });
             std::cout << "Where with " << size << " elements: " << time << " ms" << std::endl;
+            std::cout << "Parallel where with " << size << " elements: " << time_parallel << " ms" << std::endl;
+            std::cout << "In-place where with " << size << " elements: " << time_in_place << " ms" << std::endl;
             outputFile << "where," << size << "," << time << std::endl;
+            outputFile << "where_parallel," << size << "," << time_parallel << std::endl;
+            outputFile << "where_in_place," << size << "," << time_in_place << std::endl;
         }
     }
 
@@ -273,6 +392,261 @@ public:
         }
     }
 
+    void testSortedInsert() {
+        std::cout << "Testing self-balancing insertion of sorted keys..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        for (size_t size: sizes) {
+            double time_rb = measureExecutionTime([&]() {
+                BinaryTree<int, RedBlackBalancing> tree;
+                for (size_t i = 0; i < size; ++i) {
+                    tree.insert(i);
+                }
+            });
+            double time_avl = measureExecutionTime([&]() {
+                BinaryTree<int, AVLBalancing> tree;
+                for (size_t i = 0; i < size; ++i) {
+                    tree.insert(i);
+                }
+            });
+            std::cout << "Red-black insert of " << size << " sorted elements: " << time_rb << " ms" << std::endl;
+            std::cout << "AVL insert of " << size << " sorted elements: " << time_avl << " ms" << std::endl;
+            outputFile << "insert_sorted_rb," << size << "," << time_rb << std::endl;
+            outputFile << "insert_sorted_avl," << size << "," << time_avl << std::endl;
+        }
+    }
+
+    void testBulkLoad() {
+        std::cout << "Testing bulk load performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        for (size_t size: sizes) {
+            auto values = generateRandomValues(size);
+            double time = measureExecutionTime([&]() {
+                BinaryTree<int> tree;
+                tree.bulkLoad(values);
+            });
+            std::cout << "Bulk load of " << size << " elements: " << time << " ms" << std::endl;
+            outputFile << "bulk_load," << size << "," << time << std::endl;
+        }
+    }
+
+    void testSplitJoin() {
+        std::cout << "Testing split and join performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        const size_t operations = 1000;
+        for (size_t size: sizes) {
+            BinaryTree<int, OrderStatistics<RedBlackBalancing> > tree;
+            tree.bulkLoad(generateRandomValues(size));
+            std::vector<int> keys = generateRandomValues(operations);
+            double time = measureExecutionTime([&]() {
+                for (int key: keys) {
+                    auto [less, rest] = tree.split(key);
+                    tree = decltype(tree)::join(std::move(less), std::move(rest));
+                }
+            });
+            std::cout << operations << " splits and joins on " << size << " elements: " << time << " ms" << std::endl;
+            outputFile << "split_join," << size << "," << time << std::endl;
+        }
+    }
+
+    void testRemoveRange() {
+        std::cout << "Testing range removal performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        for (size_t size: sizes) {
+            std::vector<int> values(size);
+            for (size_t i = 0; i < size; i++) {
+                values[i] = static_cast<int>(i);
+            }
+            // Retire the middle tenth of the keys.
+            int low = static_cast<int>(size * 9 / 20);
+            int high = static_cast<int>(size * 11 / 20) - 1;
+
+            BinaryTree<int, RedBlackBalancing> tree;
+            tree.bulkLoad(values);
+            double time_loop = measureExecutionTime([&]() {
+                for (int value = low; value <= high; value++) {
+                    tree.remove(value);
+                }
+            });
+            tree.bulkLoad(values);
+            double time_range = measureExecutionTime([&]() {
+                tree.removeRange(low, high);
+            });
+            std::cout << "Removing " << high - low + 1 << " of " << size << " elements one by one: " << time_loop
+                    << " ms" << std::endl;
+            std::cout << "Removing " << high - low + 1 << " of " << size << " elements as a range: " << time_range
+                    << " ms" << std::endl;
+            outputFile << "remove_loop," << size << "," << time_loop << std::endl;
+            outputFile << "remove_range," << size << "," << time_range << std::endl;
+        }
+    }
+
+    void testSerialization() {
+        std::cout << "Testing serialization performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        for (size_t size: sizes) {
+            BinaryTree<int> tree;
+            tree.bulkLoad(generateRandomValues(size));
+            std::string text;
+            std::string binary;
+            double time_text = measureExecutionTime([&]() {
+                text = tree.saveToString();
+                BinaryTree<int> loaded;
+                loaded.loadFromString(text);
+            });
+            double time_binary = measureExecutionTime([&]() {
+                binary = tree.saveToBinary();
+                BinaryTree<int> loaded;
+                loaded.loadFromBinary(binary);
+            });
+            double time_stream = measureExecutionTime([&]() {
+                {
+                    std::ofstream file("tree_stream.txt");
+                    tree.save(file);
+                }
+                std::ifstream file("tree_stream.txt");
+                BinaryTree<int> loaded;
+                loaded.load(file);
+            });
+            std::remove("tree_stream.txt");
+            double time_snapshot = measureExecutionTime([&]() {
+                tree.saveSnapshot("tree_snapshot.bin");
+                FrozenTree<int> loaded = FrozenTree<int>::open("tree_snapshot.bin");
+            });
+            std::remove("tree_snapshot.bin");
+            std::cout << "Text save/load of " << size << " elements: " << time_text << " ms, "
+                    << text.size() << " bytes" << std::endl;
+            std::cout << "Binary save/load of " << size << " elements: " << time_binary << " ms, "
+                    << binary.size() << " bytes" << std::endl;
+            std::cout << "Streaming text save/load of " << size << " elements: " << time_stream << " ms" << std::endl;
+            std::cout << "Snapshot save/open of " << size << " elements: " << time_snapshot << " ms" << std::endl;
+            outputFile << "serialize_text," << size << "," << time_text << std::endl;
+            outputFile << "serialize_binary," << size << "," << time_binary << std::endl;
+            outputFile << "serialize_stream," << size << "," << time_stream << std::endl;
+            outputFile << "serialize_snapshot," << size << "," << time_snapshot << std::endl;
+        }
+    }
+
+    // One writer inserting while the readers run their lookups; returns when all of them are done.
+    template<typename Read, typename Write>
+    void runReadersAndWriter(size_t readers, const std::vector<int> &searchValues,
+                             const std::vector<int> &writeValues, Read &&read, Write &&write) {
+        std::vector<std::thread> threads;
+        threads.emplace_back([&]() {
+            for (int value: writeValues) {
+                write(value);
+            }
+        });
+        for (size_t i = 0; i < readers; ++i) {
+            threads.emplace_back([&]() {
+                for (int value: searchValues) {
+                    read(value);
+                }
+            });
+        }
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+    }
+
+    void testConcurrentAccess() {
+        std::cout << "Testing concurrent read/write performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        size_t readers = std::max(2u, std::thread::hardware_concurrency());
+        for (size_t size: sizes) {
+            auto values = generateRandomValues(size);
+            std::vector<int> searchValues = generateRandomValues(1000);
+            std::vector<int> writeValues = generateRandomValues(1000);
+            BinaryTree<int> lockedTree;
+            ConcurrentTree<int> concurrentTree;
+            for (int value: values) {
+                lockedTree.insert(value);
+                concurrentTree.insert(value);
+            }
+
+            std::mutex treeMutex;
+            double time_locked = measureExecutionTime([&]() {
+                runReadersAndWriter(readers, searchValues, writeValues, [&](int value) {
+                    std::lock_guard<std::mutex> lock(treeMutex);
+                    lockedTree.contains(value);
+                }, [&](int value) {
+                    std::lock_guard<std::mutex> lock(treeMutex);
+                    lockedTree.insert(value);
+                });
+            });
+            double time_concurrent = measureExecutionTime([&]() {
+                runReadersAndWriter(readers, searchValues, writeValues, [&](int value) {
+                    concurrentTree.contains(value);
+                }, [&](int value) {
+                    concurrentTree.insert(value);
+                });
+            });
+            std::cout << readers << " readers and a writer on " << size << " elements (global mutex): "
+                    << time_locked << " ms" << std::endl;
+            std::cout << readers << " readers and a writer on " << size << " elements (concurrent tree): "
+                    << time_concurrent << " ms" << std::endl;
+            outputFile << "concurrent_locked," << size << "," << time_locked << std::endl;
+            outputFile << "concurrent_snapshot," << size << "," << time_concurrent << std::endl;
+        }
+    }
+
+    void testVersioning() {
+        std::cout << "Testing update-and-snapshot performance..." << std::endl;
+        std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+        const size_t updates = 100;
+        // Deep copies are bounded to about ten million copied nodes and the time is scaled to the
+        // full number of updates, since every copy costs the same.
+        const size_t copiedNodesLimit = 10000000;
+        for (size_t size: sizes) {
+            auto values = generateRandomValues(size);
+            std::vector<int> updateValues = generateRandomValues(updates);
+
+            // Each strategy gets its own base tree, and its snapshots are freed after the timed
+            // region, so neither run pays for the other's teardown.
+            double time_persistent;
+            {
+                PersistentTree<int> persistentTree;
+                for (int value: values) {
+                    persistentTree = persistentTree.insert(value);
+                }
+                std::vector<PersistentTree<int> > snapshots;
+                snapshots.reserve(updates);
+                time_persistent = measureExecutionTime([&]() {
+                    for (int value: updateValues) {
+                        persistentTree = persistentTree.insert(value);
+                        snapshots.push_back(persistentTree);
+                    }
+                });
+            }
+
+            size_t copyUpdates = std::clamp<size_t>(copiedNodesLimit / size, 1, updates);
+            double time_copy;
+            {
+                BinaryTree<int> tree;
+                for (int value: values) {
+                    tree.insert(value);
+                }
+                std::vector<BinaryTree<int> > snapshots;
+                snapshots.reserve(copyUpdates);
+                time_copy = measureExecutionTime([&]() {
+                    for (size_t i = 0; i < copyUpdates; i++) {
+                        tree.insert(updateValues[i]);
+                        snapshots.push_back(tree);
+                    }
+                }) * updates / copyUpdates;
+            }
+
+            std::cout << updates << " updates with snapshots on " << size << " elements (deep copy";
+            if (copyUpdates < updates) {
+                std::cout << ", scaled from " << copyUpdates;
+            }
+            std::cout << "): " << time_copy << " ms" << std::endl;
+            std::cout << updates << " updates with snapshots on " << size << " elements (persistent tree): "
+                    << time_persistent << " ms" << std::endl;
+            outputFile << "versioning_copy," << size << "," << time_copy << std::endl;
+            outputFile << "versioning_persistent," << size << "," << time_persistent << std::endl;
+        }
+    }
+
     void runAllTests() {
         testInsert();
         testSearch();
@@ -280,6 +654,13 @@ public:
         testMap();
         testWhere();
         testBalancing();
+        testSortedInsert();
+        testBulkLoad();
+        testSplitJoin();
+        testRemoveRange();
+        testSerialization();
+        testConcurrentAccess();
+        testVersioning();
     }
 };
 
@@ -346,6 +727,20 @@ void demonstrateBinaryTree() {
         std::cout << value << " ";
     }
     std::cout << std::endl;
+    std::cout << "In-place where on a copy (odd numbers only): ";
+    BinaryTree<int> oddTree = tree;
+    oddTree.whereInPlace([](const int &x) { return x % 2 != 0; });
+    for (int value: oddTree) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "Values in range [3, 6]: ";
+    tree.rangeVisit(3, 6, [](const int &value) {
+        std::cout << value << " ";
+    });
+    std::cout << std::endl;
+    std::cout << "First value not less than 5: " << *tree.lower_bound(5)
+            << ", first value greater than 5: " << *tree.upper_bound(5) << std::endl;
     std::cout << "\nExtracting subtree with root value 3:" << std::endl;
     auto subtree = tree.extractSubtree(3);
     std::cout << "Subtree in-order traversal: ";
@@ -356,6 +751,9 @@ void demonstrateBinaryTree() {
     std::cout << std::endl;
     std::cout << "Does the original tree contain the extracted subtree? ";
     std::cout << (tree.containsSubtree(subtree) ? "Yes" : "No") << std::endl;
+    BinaryTree<int> treeCopy = tree;
+    std::cout << "Does a copy have the shape of the original tree? " << (treeCopy.sameShape(tree) ? "Yes" : "No")
+            << (treeCopy.fingerprint() == tree.fingerprint() ? " (same fingerprint)" : "") << std::endl;
     std::cout << "\nSerializing tree using KLP format: ";
     std::string serialized = tree.saveToString("KLP");
     std::cout << serialized << std::endl;
@@ -368,6 +766,28 @@ void demonstrateBinaryTree() {
         std::cout << value << " ";
     }
     std::cout << std::endl;
+    std::string binary = tree.saveToBinary();
+    BinaryTree<int> binaryTree;
+    binaryTree.loadFromBinary(binary);
+    std::cout << "Binary snapshot: " << binary.size() << " bytes (text: " << serialized.size()
+            << " bytes), restored " << binaryTree.size() << " elements, same shape: "
+            << (binaryTree.saveToString("KLP") == serialized ? "Yes" : "No") << std::endl;
+    tree.saveSnapshot("demo_snapshot.bin");
+    {
+        FrozenTree<int> snapshot = FrozenTree<int>::open("demo_snapshot.bin");
+        std::cout << "Mapped snapshot contains 4: " << (snapshot.contains(4) ? "Yes" : "No") << ", items in [3, 6]: ";
+        snapshot.rangeVisit(3, 6, [](int value) {
+            std::cout << value << " ";
+        });
+        std::cout << std::endl;
+    }
+    FrozenTree<int>().save("demo_snapshot.bin");
+    {
+        FrozenTree<int> empty = FrozenTree<int>::open("demo_snapshot.bin");
+        std::cout << "Empty snapshot restored with " << empty.size() << " items, contains 4: "
+                << (empty.contains(4) ? "Yes" : "No") << std::endl;
+    }
+    std::remove("demo_snapshot.bin");
     std::cout << "\nCreating another tree with values 10, 20, 30..." << std::endl;
     BinaryTree<int> anotherTree;
     anotherTree.insert(10);
@@ -381,6 +801,16 @@ void demonstrateBinaryTree() {
         std::cout << value << " ";
     }
     std::cout << std::endl;
+    std::cout << "Intersection of the merged tree with the original tree: ";
+    for (int value: mergedTree.intersection(tree)) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "Difference between the merged tree and the original tree: ";
+    for (int value: mergedTree.difference(tree)) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
     std::cout << "\nCreating an unbalanced tree with values 1, 2, 3, 4, 5..." << std::endl;
     BinaryTree<int> unbalancedTree;
     unbalancedTree.insert(1);
@@ -402,6 +832,96 @@ void demonstrateBinaryTree() {
         std::cout << value << " ";
     }
     std::cout << std::endl;
+    std::cout << "\nInserting 1, 2, 3, 4, 5 into a red-black tree..." << std::endl;
+    BinaryTree<int, RedBlackBalancing> redBlackTree;
+    for (int value = 1; value <= 5; ++value) {
+        redBlackTree.insert(value);
+    }
+    std::cout << "Red-black tree pre-order traversal: ";
+    for (int value: redBlackTree.traversePreOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "Inserting 1, 2, 3, 4, 5 into an AVL tree and removing 4..." << std::endl;
+    BinaryTree<int, AVLBalancing> avlTree;
+    for (int value = 1; value <= 5; ++value) {
+        avlTree.insert(value);
+    }
+    avlTree.remove(4);
+    std::cout << "AVL tree pre-order traversal: ";
+    for (int value: avlTree.traversePreOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "\nOrder statistics on values 50, 20, 80, 10, 30, 70, 90..." << std::endl;
+    BinaryTree<int, OrderStatistics<AVLBalancing> > rankedTree;
+    for (int value: {50, 20, 80, 10, 30, 70, 90}) {
+        rankedTree.insert(value);
+    }
+    std::cout << "Size: " << rankedTree.size() << ", 3rd smallest: " << rankedTree.kth(2)
+            << ", rank of 70: " << rankedTree.rank(70) << std::endl;
+    auto [belowFifty, fromFifty] = rankedTree.split(50);
+    std::cout << "Split at 50: ";
+    for (int value: belowFifty) {
+        std::cout << value << " ";
+    }
+    std::cout << "| ";
+    for (int value: fromFifty) {
+        std::cout << value << " ";
+    }
+    rankedTree = decltype(rankedTree)::join(std::move(belowFifty), std::move(fromFifty));
+    std::cout << "| joined again: " << rankedTree.size() << " items" << std::endl;
+    rankedTree.removeRange(20, 70);
+    std::cout << "After removing 20..70: ";
+    for (int value: rankedTree) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "\nMultiset with values 3, 1, 3, 2, 3, 1..." << std::endl;
+    TreeMultiset<int> multiset;
+    for (int value: {3, 1, 3, 2, 3, 1}) {
+        multiset.insert(value);
+    }
+    std::cout << "In-order: ";
+    for (int value: multiset.traverseInOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << "(" << multiset.size() << " items, " << multiset.distinctSize() << " nodes, count of 3: "
+            << multiset.count(3) << ")" << std::endl;
+    TreeMap<std::string, int> wordLengths;
+    for (std::string word: {"pear", "fig", "banana"}) {
+        wordLengths[word] = static_cast<int>(word.size());
+    }
+    std::cout << "Map: ";
+    for (const auto &[word, length]: wordLengths.traverseInOrder()) {
+        std::cout << word << "=" << length << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "\nPersistent tree versions..." << std::endl;
+    PersistentTree<int> version1 = PersistentTree<int>().insert(2).insert(1).insert(3);
+    PersistentTree<int> version2 = version1.insert(4).remove(1);
+    std::cout << "Version 1: ";
+    for (int value: version1.traverseInOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl << "Version 2: ";
+    for (int value: version2.traverseInOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
+    std::cout << "\nB-tree with values 1..20, then removing the even ones..." << std::endl;
+    BTree<int, 2> bTree;
+    for (int value = 1; value <= 20; value++) {
+        bTree.insert(value);
+    }
+    for (int value = 2; value <= 20; value += 2) {
+        bTree.remove(value);
+    }
+    std::cout << "B-tree in-order traversal: ";
+    for (int value: bTree.traverseInOrder()) {
+        std::cout << value << " ";
+    }
+    std::cout << std::endl;
 }
 
 void interactiveMenu() {
@@ -18,7 +18,8 @@ def visualize_performance():
         operations = df['operation'].unique()
         sizes = sorted(df['size'].unique())
 
-        fig, axes = plt.subplots(2, 3, figsize=(18, 12))
+        rows = (len(operations) + 2) // 3
+        fig, axes = plt.subplots(rows, 3, figsize=(18, 6 * rows))
         axes = axes.flatten()
 
         for i, operation in enumerate(operations):